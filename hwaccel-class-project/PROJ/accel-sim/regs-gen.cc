@@ -22,15 +22,13 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#ifndef PLUMBING_H_
-#define PLUMBING_H_
+/* 从accel-sim/regs.h生成驱动使用的common/reg_map.h */
 
-#include <stdint.h>
+#include <cstdio>
 
-#include <simbricks/pcie/proto.h>
+#include "regs.h"
 
-extern struct SimbricksPcieIf pcie_if;
-
-void DMAEvent(volatile union SimbricksProtoPcieH2D *msg);
-
-#endif  // ndef PLUMBING_H_
\ No newline at end of file
+int main() {
+  accelsim::PrintCHeader(stdout, kRegInfo, "COMMON_REG_MAP_H_");
+  return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ACCEL_SIM_REGS_H_
+#define ACCEL_SIM_REGS_H_
+
+/*
+ * 寄存器布局：模拟器的MMIO分发表（sim.cpp）和驱动使用的common/reg_map.h都由这里
+ * 生成（make common/reg_map.h），改寄存器只需改这一处。
+ */
+
+#include <accel-sim/regmap.h>
+
+using accelsim::Access;
+
+static constexpr accelsim::RegInfo kRegInfo[] = {
+  {"CTRL", 0x00, 8, Access::kRW,
+   "Control register: used to start the accelerator/wait for completion."},
+  {"OFF_IN", 0x10, 8, Access::kRO,
+   "Offset of the input matrix window in the BAR."},
+  {"OFF_OUT", 0x20, 8, Access::kRO,
+   "Offset of the output (partial sums) window in the BAR."},
+  {"TP_NUM", 0x30, 8, Access::kRW,
+   "Tensor-parallel degree (1, 2, 4 or 8): each output row is split into "
+   "8 / tp_num partial sums of tp_num products that get reduced on the device. "
+   "Latched when REG_CTRL is written, so it can be set per job."},
+  {"TP_LAT", 0x38, 8, Access::kRW,
+   "Latency of one level of the reduction tree in picoseconds. A job with "
+   "tp_num = 2^k spends k * REG_TP_LAT in the reduction stage."},
+
+  /* 每个卡一组，相隔32B */
+  {"DMA_LEN", 0x40, 8, Access::kRW,
+   "Requested length of the DMA operation in bytes (one per card).", 8, 32},
+  {"DMA_ADDR_IN", 0x48, 8, Access::kRW,
+   "*Physical* host address of the DMA input (one per card).", 8, 32},
+  {"DMA_ADDR_OUT", 0x50, 8, Access::kRW,
+   "*Physical* host address of the DMA output (one per card).", 8, 32},
+  {"DMA_CTRL_IN", 0x58, 2, Access::kRW,
+   "Writing starts the DMA read of the input (one per card).", 8, 32},
+  {"DMA_CTRL_OUT", 0x5A, 2, Access::kRO,
+   "Set once the output was written back (one per card).", 8, 32},
+
+  /* 主机内存中的提交/完成队列 */
+  {"SQ_BASE", 0x140, 8, Access::kRW,
+   "Physical start address of the submission ring in host memory."},
+  {"SQ_LEN", 0x148, 8, Access::kRW,
+   "Length of the submission ring (# of entries, power of two)."},
+  {"SQ_TAIL", 0x150, 8, Access::kRW,
+   "Doorbell: index of the next entry SW will write to."},
+  {"SQ_HEAD", 0x158, 8, Access::kRO,
+   "Index of the next entry the device will consume."},
+  {"CQ_BASE", 0x160, 8, Access::kRW,
+   "Physical start address of the completion ring in host memory."},
+  {"CQ_LEN", 0x168, 8, Access::kRW,
+   "Length of the completion ring (# of entries, power of two)."},
+};
+
+#endif  // ndef ACCEL_SIM_REGS_H_
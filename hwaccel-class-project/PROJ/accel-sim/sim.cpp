@@ -22,260 +22,230 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include <cstdbool>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <simbricks/pcie/if.h>
 
-extern "C" {
-  #include "../accel-sim/sim.h"
-  #include "../common/reg_defs.h"
+#include "sim.h"
+#include "regs.h"
+
+using accelsim::FieldOps;
+using accelsim::RegOps;
+
+ProjDevice::ProjDevice()
+    : jobs_(stats().Counter("JOBS")),
+      rows_dispatched_(stats().Counter("ROWS DISPATCHED")) {
 }
 
-#include <queue>
-
-std::deque<work_item_t*> work_queue;
-uint64_t CU_NUM;
-static uint8_t mem[9][8]; // 8x8再加一个状态位
-static uint8_t* states; // =mem[8]
-uint8_t ready_mem;
-static uint8_t issued;
-static uint8_t** result;
-static uint8_t result_t[8];// transpose result
-uint64_t ready_cu; // 最多64个CU
-uint8_t** dispatched; // 每个CU的内存和状态
-uint8_t finished_nums; // 完成的任务数目
-uint8_t tp_num;
-uint8_t ep_tp;
-
-uint64_t OP_START;
-uint64_t OP_FIND_LINE;
-uint64_t OP_DISPATCH;
-uint64_t OP_GET_RESULT;
-uint64_t OP_DMA;
-uint64_t OP_DONE;
-
-
-
-uint64_t OFF_IN = 0x1000; 
-uint64_t OFF_OUT = 0x2000;
-
-uint64_t op_latency;
-uint64_t matrix_size;
-uint64_t mem_size;
-
-
-uint8_t ctrl;
-uint64_t expected_time;
-
-uint64_t dma_addr_in[8];
-uint64_t dma_addr_out[8];
-uint64_t dma_len[8];
-uint16_t dma_ctrl_in[8];
-uint16_t dma_ctrl_out[8];
-
-int InitState(void) {
-  CU_NUM = 8;
-  states = mem[8];
-  ready_cu = UINT64_MAX;
-  dispatched = new uint8_t*[CU_NUM];
-  for(uint64_t i = 0; i < CU_NUM; i++){
-    dispatched[i] = new uint8_t[9];
-  }
-  result = new uint8_t*[CU_NUM];
-  for(uint64_t i = 0; i < CU_NUM; i++){
-    result[i] = new uint8_t[9]; // 9代表给那一个卡
-  }
-  finished_nums = 0;
-  ready_mem = 0;
+int ProjDevice::ParseArgs(int argc, char *argv[]) {
+  return ParseLinkArgs(argc, argv, 1, false);
+}
+
+const char *ProjDevice::Usage() {
+  return "PCI-SOCKET SHM [SYNC-PERIOD] [PCI-LATENCY]";
+}
+
+int ProjDevice::OnInit() {
+  states_ = mem_[8];
+  ready_cu_ = UINT64_MAX;
+  finished_nums_ = 0;
+  ready_mem_ = 0;
+  issued_ = 0;
+  job_ = 0;
 
   OP_START = 5000;
   OP_FIND_LINE = 25000;
   OP_DISPATCH = 25000;
   OP_GET_RESULT = 50000;
+  OP_REDUCE_LEVEL = 5000;
   OP_DMA = 5000;
   OP_DONE = 5000;
 
-  tp_num = 1;
-  ep_tp = 8 / tp_num;
-
-  ctrl = 0;
+  tp_num_ = 1;
+  job_tp_ = 1;
+  ep_tp_ = 8 / job_tp_;
 
-  expected_time = UINT64_MAX;
+  ctrl_ = 0;
 
   return 0;
 }
 
-void MMIORead(volatile struct SimbricksProtoPcieH2DRead *read)
-{
-// #ifdef DEBUG
-//   fprintf(stderr, "MMIO Read: BAR %d offset 0x%lx len %d\n", read->bar,
-//     read->offset, read->len);
-// #endif
+/******************************************************************************/
+/* 寄存器访问：布局在regs.h，下面是每个寄存器的读写操作 */
 
-  // praepare read completion
-  volatile union SimbricksProtoPcieD2H *msg = AllocPcieOut();
-  volatile struct SimbricksProtoPcieD2HReadcomp *rc = &msg->readcomp;
-  rc->req_id = read->req_id; // set req id so host can match resp to a req
+void ProjDevice::WriteCtrl(ProjDevice &d, unsigned, uint64_t val) {
+  d.ctrl_ = val;
+  d.StartJob(d.tp_num_);
+#ifdef DEBUG
+  fprintf(stderr, "MMIO Write: ctrl %d ex_time=%ld main=%ld\n", d.ctrl_,
+    d.Now() + d.OP_START, d.Now());
+#endif
+}
 
-  // zero it out in case of bad register
-  memset((void *) rc->data, 0, read->len);
+void ProjDevice::WriteTpNum(ProjDevice &d, unsigned, uint64_t val) {
+  if (val == 0 || val > 8 || (val & (val - 1))) {
+    fprintf(stderr, "MMIO Write: warning invalid tp_num %lu\n", val);
+    return;
+  }
+  d.tp_num_ = val;
+}
 
-  void *src = NULL;
+void ProjDevice::WriteDmaCtrlIn(ProjDevice &d, unsigned i, uint64_t val) {
+  d.dma_ctrl_in_[i] = val;
+  d.dma_ctrl_out_[i] = 0; // 新任务，输出尚未写回
+  d.dma().Read(d.mem_[i], d.dma_addr_in_[i], d.dma_len_[i], READ_OPAQUE(i));
+}
 
+// 环的下标用& (len - 1)回绕，长度必须是2的幂
+static bool ValidRingLen(uint64_t val) {
+  if (val == 0 || (val & (val - 1))) {
+    fprintf(stderr, "MMIO Write: warning invalid ring length %lu\n", val);
+    return false;
+  }
+  return true;
+}
 
-  if (read->offset < OFF_OUT) {
-    assert(read->len <= 8);
-    assert(read->offset % read->len == 0);
-    switch (read->offset) {
-      case REG_CTRL:
-        src = &ctrl;
-        break;
-      case REG_TP_NUM:
-        src = &tp_num;
-        break;
-      case REG_OFF_IN: src = &OFF_IN; break;
-      case REG_OFF_OUT: src = &OFF_OUT; break;
-      default:
-        if(read->offset >= REG_DMA_LEN && read->offset < (REG_DMA_LEN + 32 * 8)){
-          int i = (read->offset - REG_DMA_LEN) / 32;
-          int j = (read->offset - REG_DMA_LEN) % 32;
-          switch(j){
-            case 0: src = dma_len + i; break;
-            case 8: src = dma_addr_in + i; break;
-            case 16: src = dma_addr_out + i; break;
-            case 24: src = dma_ctrl_in + i; break;
-            case 26: src = dma_ctrl_out + i; break;
-            default:
-              fprintf(stderr, "MMIO Read: warning read from invalid register 0x%lx\n",
-                read->offset);
-          }
-        }else{
-          fprintf(stderr, "MMIO Read: warning read from invalid register 0x%lx\n",
-            read->offset);
-        }
-    }
-  } else if(read->offset < (OFF_OUT + 64) && read->offset >= OFF_OUT) {
-    src = result + (read->offset - OFF_OUT);
-  } else {
-    fprintf(stderr, "MMIO Read: warning invalid MMIO read 0x%lx\n",
-          read->offset);
+void ProjDevice::WriteSqLen(ProjDevice &d, unsigned, uint64_t val) {
+  if (!ValidRingLen(val)) {
+    return;
   }
+  d.sq_len_ = val;
+  d.sq_head_ = d.sq_tail_ = 0;
+  d.desc_pos_ = d.desc_num_ = 0;
+}
 
-  if (src)
-    memcpy((void *) rc->data, src, read->len);
+void ProjDevice::WriteSqTail(ProjDevice &d, unsigned, uint64_t val) {
+  d.sq_tail_ = val;
+  d.QueueKick();
+}
+
+void ProjDevice::WriteCqLen(ProjDevice &d, unsigned, uint64_t val) {
+  if (!ValidRingLen(val)) {
+    return;
+  }
+  d.cq_len_ = val;
+  d.cq_tail_ = 0;
+}
+
+#define F(x) FieldOps<ProjDevice, &ProjDevice::x>
+#define FIELD(x) F(x)::Read, F(x)::Write
+
+constexpr RegOps<ProjDevice> ProjDevice::kRegOps[] = {
+  {"CTRL", F(ctrl_)::Read, WriteCtrl},
+  {"OFF_IN", F(off_in_)::Read, nullptr},
+  {"OFF_OUT", F(off_out_)::Read, nullptr},
+  {"TP_NUM", F(tp_num_)::Read, WriteTpNum},
+  {"TP_LAT", FIELD(OP_REDUCE_LEVEL)},
+  {"DMA_LEN", FIELD(dma_len_)},
+  {"DMA_ADDR_IN", FIELD(dma_addr_in_)},
+  {"DMA_ADDR_OUT", FIELD(dma_addr_out_)},
+  {"DMA_CTRL_IN", F(dma_ctrl_in_)::Read, WriteDmaCtrlIn},
+  {"DMA_CTRL_OUT", F(dma_ctrl_out_)::Read, nullptr},
+  {"SQ_BASE", FIELD(sq_base_)},
+  {"SQ_LEN", F(sq_len_)::Read, WriteSqLen},
+  {"SQ_TAIL", F(sq_tail_)::Read, WriteSqTail},
+  {"SQ_HEAD", F(sq_head_)::Read, nullptr},
+  {"CQ_BASE", FIELD(cq_base_)},
+  {"CQ_LEN", F(cq_len_)::Read, WriteCqLen},
+};
+
+#undef FIELD
+#undef F
+
+// O(1)分发表，编译期生成
+static constexpr auto kRegs =
+    accelsim::MakeRegMap<kRegInfo, ProjDevice::kRegOps>();
+
+void ProjDevice::OnMmioRead(volatile struct SimbricksProtoPcieH2DRead *read)
+{
+  uint8_t data[64] = {0}; // zero it out in case of bad register
+  uint64_t val;
+  size_t len = read->len <= sizeof(data) ? read->len : 0;
+
+  if (read->offset >= off_out_ && read->offset + len <= off_out_ + 64) {
+    memcpy(data, &partial_[0][0] + (read->offset - off_out_), len);
+  } else if (len <= 8 && kRegs.Read(*this, read->offset, len, val)) {
+    memcpy(data, &val, len);
+  } else {
+    fprintf(stderr, "MMIO Read: warning read from invalid register 0x%lx\n",
+      (uint64_t) read->offset);
+  }
 
-  // send response
-  SendPcieOut(msg, SIMBRICKS_PROTO_PCIE_D2H_MSG_READCOMP);
+  ReadComplete(read, data, len);
 }
 
-void MMIOWrite(volatile struct SimbricksProtoPcieH2DWrite *write)
+void ProjDevice::OnMmioWrite(volatile struct SimbricksProtoPcieH2DWrite *write)
 {
 #ifdef DEBUG
   fprintf(stderr, "MMIO Write: BAR %d offset 0x%lx len %d\n", write->bar,
-    write->offset, write->len);
+    (uint64_t) write->offset, write->len);
 #endif
 
-  // FILL ME IN
-  // THIS PROBABLY NEEDS CHANGES BEYOND SWTICH CASES
-
-  if (write->offset < (OFF_IN + 8 * 8)) {
-    assert(write->len <= 8);
-    assert(write->offset % write->len == 0);
-    if(write->offset == REG_CTRL){
-      memcpy(&ctrl, (const void *) write->data, write->len);
-      work_item_t *work = new work_item_t;
-      work->type = FIND_LINE;
-      work->expected_time = main_time + OP_START;
-      AddWork(work);
-#ifdef DEBUG
-      fprintf(stderr, "MMIO Write: ctrl %d ex_time=%ld main=%ld\n", ctrl,expected_time, main_time);
-#endif
-    }else if(write->offset >= REG_DMA_LEN && write->offset < (REG_DMA_LEN + 32 * 8)){
-      int i = (write->offset - REG_DMA_LEN) / 32;
-      int j = (write->offset - REG_DMA_LEN) % 32;
-      switch(j){
-        case 0: memcpy(dma_len + i, (const void *) write->data, write->len); break;
-        case 8: memcpy(dma_addr_in + i, (const void *) write->data, write->len); break;
-        case 16: memcpy(dma_addr_out + i, (const void *) write->data, write->len); break;
-        case 24: memcpy(dma_ctrl_in + i, (const void *) write->data, write->len); 
-        IssueDMARead(mem[i], dma_addr_in[i], dma_len[i], READ_OPAQUE(i));break; // TODO: 搬走
-        default:
-          fprintf(stderr, "MMIO Write: warning invalid MMIO write 0x%lx\n", write->offset);
-      }
-    }else if(write->offset >= OFF_IN && write->offset < (OFF_IN + 8 * 8)){
-      memcpy(mem[write->offset - OFF_IN], (const void *) write->data, write->len);
-    }else {
-      switch (write->offset) {
-      case REG_TP_NUM:
-        tp_num = *(uint8_t *)write->data;
-        ep_tp = 8 / tp_num;
-        break;
-      default:
-      fprintf(stderr, "MMIO Write: warning invalid MMIO write 0x%lx\n",
-        write->offset);
-      }
+  if (write->offset >= off_in_ && write->offset + write->len <= off_in_ + 8 * 8) {
+    memcpy(&mem_[0][0] + (write->offset - off_in_), (const void *) write->data,
+      write->len);
+    return;
+  }
 
-    }
+  uint64_t val = 0;
+  if (write->len > 8) {
+    fprintf(stderr, "MMIO Write: warning invalid MMIO write 0x%lx\n",
+      (uint64_t) write->offset);
+    return;
   }
-}
-void PollEvent(void) {
-  if(main_time >= expected_time){
-    while(!work_queue.empty() & (work_queue.front()->expected_time <= main_time)){
-      work_item_t *work = work_queue.front();
-      work_queue.pop_front();
-      ProcessWork(work);
-    }
-    
-    if(!ctrl){
-      expected_time = UINT64_MAX;
-      clean_states();
-      return;
-    }
+  memcpy(&val, (const void *) write->data, write->len);
+  if (!kRegs.Write(*this, write->offset, write->len, val)) {
+    fprintf(stderr, "MMIO Write: warning invalid MMIO write 0x%lx\n",
+      (uint64_t) write->offset);
   }
 }
 
-uint64_t NextEvent(void) {
-  if(main_time != UINT64_MAX){
-    return expected_time;
-  }
-  return UINT64_MAX;
+/******************************************************************************/
+/* 流水线：每个阶段是一个调度器事件 */
+
+void ProjDevice::AddWork(work_t type, uint64_t delay, uint64_t data) {
+  Schedule(Now() + delay, type | (job_ << 8), data);
+  #ifdef DEBUG
+  fprintf(stderr, "AddWork: type = %d   expected_time = %ld\n", type,
+    Now() + delay);
+  #endif
+}
+
+void ProjDevice::StartJob(uint8_t tp) {
+  job_tp_ = tp;
+  ep_tp_ = 8 / job_tp_;
+  AddWork(FIND_LINE, OP_START);
 }
 
-void ProcessWork(work_item_t *work){
-  work_item_t *new_work;
-  switch(work->type){
+void ProjDevice::OnEvent(uint32_t id, uint64_t data) {
+  if ((id >> 8) != (job_ & 0xffffff)) {
+    return; // 已结束的任务
+  }
+
+  switch((work_t) (id & 0xff)){
     case FIND_LINE:{
       #ifdef DEBUG
       fprintf(stderr, "FIND_LINE\n");
       #endif
-    ready_mem = 0;
+    ready_mem_ = 0;
     for (int i = 0; i < 8; i++) {
-      if (states[i] == 0xFF && !(issued & (1 << i))) { // 8个bit为1意味全部写入完成
-        ready_mem |= 1 << i;
+      if (states_[i] == 0xFF && !(issued_ & (1 << i))) { // 8个bit为1意味全部写入完成
+        ready_mem_ |= 1 << i;
       }
     }
-    if(ctrl){
-      new_work = new work_item_t;
-      new_work->type = FIND_LINE;
-      new_work->expected_time = main_time + OP_FIND_LINE;
-      AddWork(new_work);
+    if(ctrl_){
+      AddWork(FIND_LINE, OP_FIND_LINE);
     }
-    
-    issued |= ready_mem; // 已经检查完毕的
-    if(ready_mem){ // 只要此时仍有可以发射的
-      new_work = new work_item_t;
-      new_work->type = DISPATCH;
-      new_work->expected_time = main_time + OP_DISPATCH;
-      new_work->data = (uint64_t)ready_mem;
-      AddWork(new_work);
+
+    issued_ |= ready_mem_; // 已经检查完毕的
+    if(ready_mem_){ // 只要此时仍有可以发射的
+      AddWork(DISPATCH, OP_DISPATCH, ready_mem_);
     }
     break;
   }
     case DISPATCH:{
-    uint8_t process_mem = (uint8_t)work->data;
+    uint8_t process_mem = (uint8_t)data;
     uint64_t dispatched_cu = 0;
     #ifdef DEBUG
     fprintf(stderr, "DISPATCH: process_mem = %b\n", process_mem);
@@ -284,10 +254,10 @@ void ProcessWork(work_item_t *work){
       if(process_mem == 0){// 全部任务分配完了
         break;
       }
-      if(!(ready_cu & (1 << i))){ // 该CU不可用
+      if(!(ready_cu_ & (1 << i))){ // 该CU不可用
         continue;
       }
-      ready_cu &= ~(1 << i); // 该CU改为不可用
+      ready_cu_ &= ~(1 << i); // 该CU改为不可用
       dispatched_cu |= 1 << i; // 该CU已经分配任务
       // 找到最低位的1（不必须）
       int j = 0;
@@ -298,31 +268,26 @@ void ProcessWork(work_item_t *work){
 
       // 复制到CU的内存中
       for(int k = 0; k < 8; k++){
-        dispatched[i][k] = mem[k][j];
+        dispatched_[i][k] = mem_[k][j];
       }
-      dispatched[i][8] = j;// [8]状态位，表示第几行
+      dispatched_[i][8] = j;// [8]状态位，表示第几行
+      rows_dispatched_++;
     }
     if(dispatched_cu){ // 有任务成功分配
-      new_work = new work_item_t;
-      new_work->type = GET_RESULT;
-      new_work->expected_time = main_time + OP_GET_RESULT;
-      new_work->data = dispatched_cu;
-      AddWork(new_work);
+      AddWork(GET_RESULT, OP_GET_RESULT, dispatched_cu);
     }
     if(process_mem){ // 仍然有任务未处理
-      new_work = new work_item_t;
-      new_work->type = DISPATCH;
-      new_work->expected_time = main_time + OP_DISPATCH;
-      new_work->data = (uint64_t)process_mem;
-      AddWork(new_work);
+      AddWork(DISPATCH, OP_DISPATCH, process_mem);
     }
     break;
   }
     case GET_RESULT:{
-    uint64_t result_cu = work->data;
+    uint64_t result_cu = data;
+    uint64_t rows = 0;
     #ifdef DEBUG
-    fprintf(stderr, "GET_RESULT: result_cu = %b\n", result_cu);
+    fprintf(stderr, "GET_RESULT: result_cu = %lb\n", result_cu);
     #endif
+    // 只取回CU的乘积并释放CU，规约在单独的REDUCE阶段完成，与下一次DISPATCH重叠
     for(uint64_t i = 0; i < CU_NUM; i++){
       if(result_cu == 0){
         break;
@@ -331,124 +296,186 @@ void ProcessWork(work_item_t *work){
         continue;
       }
       result_cu &= ~(1 << i);
-      ready_cu |= 1 << i; // 该CU变为可用
-      for(int j = 0;j < ep_tp; j++){
-        for(int k = 0; k < tp_num; k++){
-          result[i][j] += dispatched[i][j * tp_num + k];
+      ready_cu_ |= 1 << i; // 该CU变为可用
+      uint8_t row = dispatched_[i][8];
+      memcpy(partial_[row], dispatched_[i], 8);
+      rows |= 1 << row;
+      dispatched_[i][8] = 0;
+    }
+    AddWork(REDUCE, ReduceLatency(), rows);
+    break;
+  }
+    case REDUCE:{
+    uint64_t rows = data;
+    #ifdef DEBUG
+    fprintf(stderr, "REDUCE: rows = %lb tp_num = %d\n", rows, job_tp_);
+    #endif
+    for(int r = 0; r < 8; r++){
+      if(!(rows & (1 << r))){
+        continue;
+      }
+      // 规约树：每层把相距stride的部分和两两相加
+      for(int stride = 1; stride < job_tp_; stride <<= 1){
+        for(int j = 0; j < 8; j += 2 * stride){
+          partial_[r][j] += partial_[r][j + stride];
         }
       }
-      result[i][8] = dispatched[i][8];
-      dispatched[i][8] = 0;
+      for(int j = 0; j < ep_tp_; j++){
+        partial_[r][j] = partial_[r][j * job_tp_];
+      }
     }
-    new_work = new work_item_t;
-    new_work->type = DMA;
-    new_work->expected_time = main_time + OP_DMA;
-    new_work->data = work->data;
-    AddWork(new_work);
+    AddWork(DMA, OP_DMA, rows);
     break;
   }
     case DMA:{
-    uint64_t finished_cu = work->data;
+    uint64_t rows = data;
     #ifdef DEBUG
-    fprintf(stderr, "DMA: finished_cu = %b\n", finished_cu);
+    fprintf(stderr, "DMA: rows = %lb\n", rows);
     #endif
-    for(uint64_t i = 0; i < CU_NUM; i++){
-      if(finished_cu & (1 << i)){ 
-        for(int j = 0; j < ep_tp; j++){
-          result_t[j] = result[i][j];
-        }
-        IssueDMAWrite(dma_addr_out[result[i][8]], result_t, ep_tp, WRITE_OPAQUE(result[i][8]));
-        for(int j = 0; j < ep_tp; j++){
-          result[i][j] = 0;
-        }
+    for(int r = 0; r < 8; r++){
+      if(rows & (1 << r)){
+        dma().Write(dma_addr_out_[r], partial_[r], ep_tp_, WRITE_OPAQUE(r));
       }
     }
-    if(!work_queue.empty()){
-      expected_time = work_queue.front()->expected_time;
-    }
     break;
   }
     case DONE:
     #ifdef DEBUG
-    fprintf(stderr, "DONE  main=%ld\n", main_time);
+    fprintf(stderr, "DONE  main=%ld\n", Now());
     #endif
-    ctrl = 0;
+    ctrl_ = 0;
+    jobs_++;
+    if(q_busy_){
+      QueueJobDone();
+    }
+    CleanStates();
+    QueueKick();
     break;
 
   }
-
-  delete work;
 }
 
-void AddWork(work_item_t *work){
-  // Insert work into the queue in the order of expected_time
-  if (work_queue.empty()) {
-    work_queue.push_back(work);
-  } else {
-    std::deque<work_item_t*>::iterator it = work_queue.begin();
-    while (it != work_queue.end() && (*it)->expected_time < work->expected_time) {
-      it++;
-    }
-    work_queue.insert(it, work);
+// 规约树深度为log2(tp_num)，每层耗时OP_REDUCE_LEVEL
+uint64_t ProjDevice::ReduceLatency() const {
+  uint64_t levels = 0;
+  for(uint8_t t = job_tp_; t > 1; t >>= 1){
+    levels++;
   }
-  expected_time = work_queue.front()->expected_time;
-  #ifdef DEBUG
-  fprintf(stderr, "AddWork: type = %d   work->expected_time = %ld  expected_time = %ld\n",work->type, work->expected_time,expected_time);
-  #endif
+  return levels * OP_REDUCE_LEVEL;
 }
 
-
-void DMACompleteEvent(uint64_t opaque) {
+void ProjDevice::OnDmaComplete(uint64_t opaque) {
   if(opaque >= 0x1000 && opaque < 0x2000){
     #ifdef DEBUG
     fprintf(stderr, "DMACompleteRead %lx\n", opaque);
     #endif
-    dma_ctrl_in[opaque - 0x1000] = 0; // 读取数据完毕
+    dma_ctrl_in_[opaque - 0x1000] = 0; // 读取数据完毕
     for(int i = 0; i < 8; i++){
-      states[i] |= 1 << (opaque - 0x1000);
+      states_[i] |= 1 << (opaque - 0x1000);
     }
+  }else if(opaque == FETCH_OPAQUE){
+    fetching_ = false;
+    QueueKick();
+  }else if(opaque == JOB_IN_OPAQUE){
+    // 整个8x8输入已到达，等同于8个REG_DMA_CTRL_IN都完成
+    for(int i = 0; i < 8; i++){
+      states_[i] = 0xFF;
+      dma_addr_out_[i] = cur_job_.out_addr + 8 * i;
+      dma_ctrl_out_[i] = 0;
+    }
+    ctrl_ = 1;
+    #ifdef DEBUG
+    fprintf(stderr, "QueueStart: job %u main=%ld\n", cur_job_.job_id, Now());
+    #endif
+    StartJob(cur_job_.tp_num);
+  }else if(opaque == CPL_OPAQUE){
+    // 完成项已写回，无需处理
   }else if(opaque >= 0x2000 && opaque < 0x3000){
-    dma_ctrl_out[opaque - 0x2000] = 1;
-    finished_nums++; // 完成的任务数目
-    if(finished_nums == 8){
-      work_item_t* new_work = new work_item_t;
-      new_work->type = DONE;
-      new_work->expected_time = main_time + OP_DONE;
-      AddWork(new_work);
+    dma_ctrl_out_[opaque - 0x2000] = 1;
+    finished_nums_++; // 完成的任务数目
+    if(finished_nums_ == 8){
+      AddWork(DONE, OP_DONE);
     }
     #ifdef DEBUG
-    fprintf(stderr, "DMACompleteWrite %lx time = %ld\n", opaque,main_time);
-    fprintf(stderr, "finished_nums = %d\n", finished_nums);
+    fprintf(stderr, "DMACompleteWrite %lx time = %ld\n", opaque, Now());
+    fprintf(stderr, "finished_nums = %d\n", finished_nums_);
     #endif
   }
-  if(!work_queue.empty())
-    expected_time = work_queue.front()->expected_time;
 }
 
-//  TODO：归零
-void clean_states(){
+// 任务结束后归零，旧任务还未触发的事件随任务编号失效
+void ProjDevice::CleanStates(){
   for(int i = 0; i < 8; i++){
-    states[i] = 0;
+    states_[i] = 0;
   }
-  ready_cu = UINT64_MAX;
-  finished_nums = 0;
-  issued = 0;
-  ready_mem = 0;
-  tp_num = 1;
-  for(uint64_t i = 0; i < CU_NUM; i++){
-    delete[] dispatched[i];
+  ready_cu_ = UINT64_MAX;
+  finished_nums_ = 0;
+  issued_ = 0;
+  ready_mem_ = 0;
+  job_++;
+  // tp_num和规约延迟寄存器跨任务保留，由驱动按任务设置
+  #ifdef DEBUG
+  fprintf(stderr, "clean_states\n");
+  #endif
+}
+
+
+void ProjDevice::QueueKick(){
+  if(q_busy_ || ctrl_ || !sq_len_ || !cq_len_){
+    return;
   }
-  delete[] dispatched;
-  for(uint64_t i = 0; i < CU_NUM; i++){
-    delete[] result[i];
+
+  if(desc_pos_ < desc_num_){
+    cur_job_ = descs_[desc_pos_++];
+    if(cur_job_.tp_num == 0 || cur_job_.tp_num > 8 ||
+        (cur_job_.tp_num & (cur_job_.tp_num - 1))){
+      fprintf(stderr, "QueueKick: warning invalid tp_num %d in job %u\n",
+        cur_job_.tp_num, cur_job_.job_id);
+      cur_job_.tp_num = 1;
+    }
+    q_busy_ = true;
+    #ifdef DEBUG
+    fprintf(stderr, "QueueKick: job %u time = %ld\n", cur_job_.job_id, Now());
+    #endif
+    dma().Read(mem_[0], cur_job_.in_addr, 64, JOB_IN_OPAQUE);
+    return;
+  }
+
+  if(fetching_ || sq_head_ == sq_tail_){
+    return;
   }
-  delete[] result;
-  while(!work_queue.empty()){
-    work_item_t *work = work_queue.front();
-    work_queue.pop_front();
-    delete work;
+
+  // 批量取回描述符，不跨越环的末尾
+  uint64_t n = (sq_tail_ - sq_head_) & (sq_len_ - 1);
+  if(n > sq_len_ - sq_head_){
+    n = sq_len_ - sq_head_;
+  }
+  if(n > SQ_FETCH_BATCH){
+    n = SQ_FETCH_BATCH;
   }
+  desc_pos_ = 0;
+  desc_num_ = n;
+  fetching_ = true;
+  dma().Read(descs_, sq_base_ + sq_head_ * sizeof(struct job_desc),
+    n * sizeof(struct job_desc), FETCH_OPAQUE);
+}
+
+void ProjDevice::QueueJobDone(){
+  struct job_cpl *cpl = &cpls_[cq_tail_ % SQ_FETCH_BATCH];
+  memset(cpl, 0, sizeof(*cpl));
+  cpl->job_id = cur_job_.job_id;
+  cpl->valid = 1;
+  dma().Write(cq_base_ + cq_tail_ * sizeof(*cpl), cpl, sizeof(*cpl),
+    CPL_OPAQUE);
+  cq_tail_ = (cq_tail_ + 1) & (cq_len_ - 1);
+  sq_head_ = (sq_head_ + 1) & (sq_len_ - 1);
+  q_busy_ = false;
   #ifdef DEBUG
-  fprintf(stderr, "clean_states\n");
+  fprintf(stderr, "QueueJobDone: job %u time = %ld\n", cur_job_.job_id, Now());
   #endif
-}
\ No newline at end of file
+}
+
+int main(int argc, char *argv[]) {
+  static ProjDevice dev;
+  return dev.Main(argc, argv);
+}
@@ -25,107 +25,124 @@
 #ifndef ACCEL_SIM_SIM_H_
 #define ACCEL_SIM_SIM_H_
 
-#include <stdint.h>
+#include <cstdint>
 
-#include <simbricks/pcie/proto.h>
+#include <accel-sim/device.h>
+
+#include "../common/reg_defs.h"
 
 // uncomment to enable debug prints
 #define DEBUG
 
 #define READ_OPAQUE(x) (0x1000 + (x))
 #define WRITE_OPAQUE(x) (0x2000 + (x))
+#define FETCH_OPAQUE 0x3000
+#define JOB_IN_OPAQUE 0x3001
+#define CPL_OPAQUE 0x3002
 
-
+/* 流水线的各个阶段，作为调度器的事件id（低8位，高位是任务编号） */
 typedef enum {
   FIND_LINE,
   DISPATCH,
   GET_RESULT,
+  REDUCE,
   DMA,
   DONE
 } work_t;
-  
-typedef struct {
-  uint64_t expected_time;
-  work_t type;
-  uint64_t data;
-} work_item_t;
-
-/******************************************************************************/
-/* Utility definitions provided by the framework. */
-
-/** Current simulation time (in piocoseconds) */
-extern uint64_t main_time;
-
-/** Allocate a PCIe message to send out. Must be followed by a call to
- *  SendPcieOut. */
-volatile union SimbricksProtoPcieD2H *AllocPcieOut(void);
-
-/** Send out a PCIe message. msg must have been previously allocated with
- * AllocPcieOut.
- * @param type SimBricks PCIe message type.
- */
-void SendPcieOut(volatile union SimbricksProtoPcieD2H *msg, uint64_t type);
-
 
 /**
- * Issue a DMA Read operation (read data from host memory).
- * @param dst      Destination pointer in the simulator
- * @param src_addr *Physical* address on the host.
- * @param len      Number of bytes to read.
- * @param opaque   Value passt back to `DMACompleteEvent` when called on
- *                 completion.
+ * PROJ加速器模型：8个CU处理8x8任务的各列，按tp_num规约后DMA写回。每个阶段是
+ * 一个调度器事件，任务来自寄存器（REG_CTRL）或主机内存中的提交队列。
  */
-void IssueDMARead(void *dst, uint64_t src_addr, size_t len, uint64_t opaque);
-
-/**
- * Issue a DMA Write operation (write data to host memory).
- * @param dst_addr *Physical* address on the host.
- * @param src      Source pointer in the simulator
- * @param len      Number of bytes to write.
- * @param opaque   Value passt back to `DMACompleteEvent` when called on
- *                 completion.
- */
-void IssueDMAWrite(uint64_t dst_addr, const void *src, size_t len,
-    uint64_t opaque);
-
-
-/******************************************************************************/
-/* Functions you will implement in sim.c */
-
-/**
- * Called once during initialization. Use this to initialize your internal
- * simulation model state.
-*/
-int InitState(void);
-
-/**
- * Called for every register read. You must complete each operation with a
- * corresponding read completion sent with SendPcieOut.
-*/
-void MMIORead(volatile struct SimbricksProtoPcieH2DRead *read);
-
-/**
- * Called for every register write. No completion message needed.
-*/
-void MMIOWrite(volatile struct SimbricksProtoPcieH2DWrite *write);
-
-/** Called by simulation loop to enable you to process potentially pending
- * events in your simulation model. */
-void PollEvent(void);
-
-/** Must return the time your next simulation event will be due to be processed
- * by PollEvent (or an earlier time). If no event is pending, return
- * UINT64_MAX. */
-uint64_t NextEvent(void);
-
-/** Called when a DMA operation is completed. Opaque value is the one passed in
- * on DMA issue. */
-void DMACompleteEvent(uint64_t opaque);
-
-void ProcessWork(work_item_t *work);
-
-
-void AddWork(work_item_t *work);
-
-void clean_states();
-#endif  // ndef ACCEL_SIM_SIM_H_
\ No newline at end of file
+class ProjDevice : public accelsim::Device<ProjDevice> {
+ public:
+  ProjDevice();
+
+  int ParseArgs(int argc, char *argv[]);
+  const char *Usage();
+  int OnInit();
+  void OnMmioRead(volatile struct SimbricksProtoPcieH2DRead *read);
+  void OnMmioWrite(volatile struct SimbricksProtoPcieH2DWrite *write);
+  void OnEvent(uint32_t id, uint64_t data);
+  void OnDmaComplete(uint64_t opaque);
+
+  /** 寄存器的读写操作，与regs.h中的kRegInfo一一对应 */
+  static const accelsim::RegOps<ProjDevice> kRegOps[];
+
+ private:
+  static constexpr unsigned CU_NUM = 8;
+
+  /* 流水线 */
+  void AddWork(work_t type, uint64_t delay, uint64_t data = 0);
+  void StartJob(uint8_t tp);
+  /** 当前任务的规约树延迟 */
+  uint64_t ReduceLatency() const;
+  void CleanStates();
+
+  /* 提交/完成队列 */
+  /** 设备空闲时开始提交队列中的下一个任务（或取回更多描述符） */
+  void QueueKick();
+  /** 为当前队列任务写回完成项 */
+  void QueueJobDone();
+
+  /* 有副作用的寄存器写 */
+  static void WriteCtrl(ProjDevice &d, unsigned, uint64_t val);
+  static void WriteTpNum(ProjDevice &d, unsigned, uint64_t val);
+  static void WriteDmaCtrlIn(ProjDevice &d, unsigned i, uint64_t val);
+  static void WriteSqLen(ProjDevice &d, unsigned, uint64_t val);
+  static void WriteSqTail(ProjDevice &d, unsigned, uint64_t val);
+  static void WriteCqLen(ProjDevice &d, unsigned, uint64_t val);
+
+  uint8_t mem_[9][8] = {}; // 8x8再加一个状态位
+  uint8_t *states_ = nullptr; // =mem_[8]
+  uint8_t ready_mem_ = 0;
+  uint8_t issued_ = 0;
+  uint8_t partial_[8][8] = {}; // 每行的部分和，REDUCE阶段原地规约
+  uint64_t ready_cu_ = 0; // 最多64个CU
+  uint8_t dispatched_[CU_NUM][9] = {}; // 每个CU的内存和状态
+  uint8_t finished_nums_ = 0; // 完成的任务数目
+  uint64_t tp_num_ = 0; // 寄存器值，下一个任务生效
+  uint8_t job_tp_ = 0; // 当前任务的tp_num（开始时锁存）
+  uint8_t ep_tp_ = 0;
+  uint32_t job_ = 0; // 任务编号，旧任务残留的事件据此忽略
+
+  uint64_t OP_START;
+  uint64_t OP_FIND_LINE;
+  uint64_t OP_DISPATCH;
+  uint64_t OP_GET_RESULT;
+  uint64_t OP_REDUCE_LEVEL; // 规约树每一层的延迟
+  uint64_t OP_DMA;
+  uint64_t OP_DONE;
+
+  uint64_t off_in_ = 0x1000;
+  uint64_t off_out_ = 0x2000;
+
+  uint8_t ctrl_ = 0;
+
+  uint64_t dma_addr_in_[8] = {};
+  uint64_t dma_addr_out_[8] = {};
+  uint64_t dma_len_[8] = {};
+  uint16_t dma_ctrl_in_[8] = {};
+  uint16_t dma_ctrl_out_[8] = {};
+
+  // 主机内存中的提交/完成队列
+  uint64_t sq_base_ = 0;
+  uint64_t sq_len_ = 0;
+  uint64_t sq_tail_ = 0; // 门铃
+  uint64_t sq_head_ = 0; // 下一个要消费的描述符
+  uint64_t cq_base_ = 0;
+  uint64_t cq_len_ = 0;
+  uint64_t cq_tail_ = 0;
+  struct job_desc descs_[SQ_FETCH_BATCH] = {}; // 已取回的描述符
+  uint64_t desc_pos_ = 0; // descs_中下一个要执行的
+  uint64_t desc_num_ = 0; // descs_中有效的个数
+  bool fetching_ = false; // 正在DMA读取描述符
+  bool q_busy_ = false; // 正在执行队列中的任务
+  struct job_desc cur_job_ = {};
+  struct job_cpl cpls_[SQ_FETCH_BATCH] = {}; // 完成项的发送缓冲
+
+  uint64_t &jobs_;
+  uint64_t &rows_dispatched_;
+};
+
+#endif  // ndef ACCEL_SIM_SIM_H_
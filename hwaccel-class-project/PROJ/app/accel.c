@@ -57,6 +57,19 @@ void matmult(const uint8_t * restrict inA, const uint8_t * restrict inB,
   }
 }
 
+/* software reference for one 8x8 job: the products for column c are the
+   input column, reduced as 8 / tp partial sums of tp consecutive rows each */
+void reduce_ref(const uint8_t *in, uint8_t *out, uint8_t tp) {
+  for (int c = 0; c < 8; c++) {
+    for (int j = 0; j < 8 / tp; j++) {
+      uint8_t sum = 0;
+      for (int s = 0; s < tp; s++)
+        sum += in[(j * tp + s) * 8 + c];
+      out[c * 8 + j] = sum;
+    }
+  }
+}
+
 void test_connection(void)
 {
 
@@ -69,12 +82,52 @@ void test_functionality(size_t n)
   for (size_t i = 0; i < n; i++) {
     A[i] = i;
   }
+
+  uint64_t start = rdtsc();
   accel(A,out,n);
+  printf("Cycles per operation: %ld\n", rdtsc() - start);
+
+  // 8x8输入
+  // 8x4输出
+  for (int i = 0; i < 8; i++) {
+    fprintf(stderr, "out[%d] = %d\n", i, *(out + i * 32));
+  }
 }
 
 void measure(size_t n, size_t iterations)
 {
-  
+  static const uint8_t tps[] = {1, 2, 4, 8};
+  uint8_t *in = rand_matrix_alloc(iterations, 64);
+  uint8_t *out = zero_matrix_alloc(iterations, 64);
+
+  for (size_t t = 0; t < sizeof(tps) / sizeof(tps[0]); t++) {
+    accel_set_tp_num(tps[t]);
+
+    /* all jobs are queued back-to-back from this one thread */
+    memset(out, 0, iterations * 64);
+    uint64_t start = rdtsc();
+    accel_batch(in, out, iterations);
+    uint64_t total_cycles = rdtsc() - start;
+
+    printf("TP %u: Cycles per operation: %ld\n", tps[t],
+        total_cycles / iterations);
+
+    /* only the first 8 / tp bytes of each output column are written */
+    bool match = true;
+    for (size_t i = 0; i < iterations && match; i++) {
+      uint8_t ref[64];
+      reduce_ref(in + i * 64, ref, tps[t]);
+      for (int c = 0; c < 8 && match; c++) {
+        if (memcmp(out + i * 64 + c * 8, ref + c * 8, 8 / tps[t])) {
+          printf("TP %u: STATUS: Failed job %zu column %d does not match\n",
+              tps[t], i, c);
+          match = false;
+        }
+      }
+    }
+    if (match)
+      printf("TP %u: STATUS: Success matrices match\n", tps[t]);
+  }
 }
 
 int main(int argc, char *argv[])
@@ -26,30 +26,43 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <vfio-pci.h>
 #include <dma-alloc.h>
 
 #include "../common/reg_defs.h"
 #include "driver.h"
-#include <string.h>
-#include <pthread.h>
-#define GNU_SOURCE
 
 /** Use this macro to safely access a register at a specific offset */
 #define ACCESS_REG(r) (*(volatile uint64_t *) ((uintptr_t) regs + r))
-#define ACCESS_REG_BYTE(r) (*(volatile uint8_t *) ((uintptr_t) regs + r))
+
+/** Number of entries in the submission and completion rings. At most
+    SQ_LEN - 1 jobs can be outstanding, as head == tail means empty. */
+#define SQ_LEN 64
+/** Bytes of input and output per 8x8 job */
+#define JOB_SIZE 64
 
 static void *regs;
 
 static bool use_dma;
-static size_t dma_mem_size = 16 * 1024;
-static uint8_t *dma_mem;
-static uintptr_t dma_mem_phys;
 
-static uint8_t *dma_out;
-static uintptr_t dma_out_phys;
-static size_t dma_out_size = 8 * 32;
+/* submission and completion rings */
+static volatile struct job_desc *sq;
+static uintptr_t sq_phys;
+static volatile struct job_cpl *cq;
+static uintptr_t cq_phys;
+static uint32_t sq_tail;
+static uint32_t cq_head;
+
+/* per ring slot input and output buffers */
+static uint8_t *job_in;
+static uintptr_t job_in_phys;
+static volatile uint8_t *job_out;
+static uintptr_t job_out_phys;
+
+/* tensor-parallel degree, put in every descriptor */
+static uint8_t tp_num = 2;
 
 int accelerator_init(bool dma) {
   struct vfio_dev dev;
@@ -72,126 +85,95 @@ int accelerator_init(bool dma) {
       return -1;
     }
 
-    if (!(dma_mem = dma_alloc_alloc(dma_mem_size, &dma_mem_phys))) {
-      fprintf(stderr, "Allocating DMA memory failed\n");
+    if (!(sq = dma_alloc_alloc(SQ_LEN * sizeof(*sq), &sq_phys)) ||
+        !(cq = dma_alloc_alloc(SQ_LEN * sizeof(*cq), &cq_phys))) {
+      fprintf(stderr, "Allocating DMA queue memory failed\n");
       return -1;
     }
-    if (!(dma_out = dma_alloc_alloc(dma_out_size, &dma_out_phys))) {
-      fprintf(stderr, "Allocating DMA DB memory failed\n");
+    if (!(job_in = dma_alloc_alloc(SQ_LEN * JOB_SIZE, &job_in_phys)) ||
+        !(job_out = dma_alloc_alloc(SQ_LEN * JOB_SIZE, &job_out_phys))) {
+      fprintf(stderr, "Allocating DMA job memory failed\n");
       return -1;
     }
-
+    memset((void *) cq, 0, SQ_LEN * sizeof(*cq));
 
     if (vfio_busmaster_enable(&dev)) {
       fprintf(stderr, "Enabling busmastering failed\n");
       return -1;
     }
-  }
 
-  // FILL ME IN
+    ACCESS_REG(REG_SQ_BASE) = sq_phys;
+    ACCESS_REG(REG_SQ_LEN) = SQ_LEN;
+    ACCESS_REG(REG_CQ_BASE) = cq_phys;
+    ACCESS_REG(REG_CQ_LEN) = SQ_LEN;
+    sq_tail = 0;
+    cq_head = 0;
+  }
 
   return 0;
 }
 
-#include "utils.h"
-
-
-
-static pthread_barrier_t barrier;
-
-// 线程参数结构体
-typedef struct {
-    int thread_id;
-    const uint8_t *A;
-    uint8_t *out;
-    size_t n;
-} thread_arg_t;
-
-// 线程处理函数
-void *thread_handler(void *arg) {
-    thread_arg_t *t_arg = (thread_arg_t *)arg;
-    int i = t_arg->thread_id;
-    size_t n = t_arg->n;
-    
-    // 计算偏移量
-    int off = i * 32;
-    
-    // 设置 DMA 地址和长度
-    ACCESS_REG(REG_DMA_ADDR_IN + off) = dma_mem_phys;
-    ACCESS_REG(REG_DMA_ADDR_OUT + off) = dma_out_phys + i * 32; // 32Byte
-    ACCESS_REG(REG_DMA_LEN + off) = n;
-    
-
-    ACCESS_REG_BYTE(REG_DMA_CTRL_IN + off) = 1;
-    while (ACCESS_REG_BYTE(REG_DMA_CTRL_IN + off))
-        ;
-    
-    // TODO: BUG: 某个线程（一般1号）偶尔无法启动/启动极慢
-    pthread_barrier_wait(&barrier);
-    
-    // 只让线程 0 触发处理并等待
-    if (i == 0) {
-        ACCESS_REG_BYTE(REG_CTRL) = 1;
-        while (ACCESS_REG_BYTE(REG_CTRL))
-            ;
+void accel_set_tp_num(uint8_t tp) {
+  tp_num = tp;
+}
+
+/* wait for the next completion and copy the job's output out */
+static void reap_one(uint8_t *out) {
+  volatile struct job_cpl *cpl = &cq[cq_head];
+  while (!cpl->valid)
+    ;
+
+  uint32_t id = cpl->job_id;
+  memcpy(out + (size_t) id * JOB_SIZE,
+      (const void *) (job_out + (id % SQ_LEN) * JOB_SIZE), JOB_SIZE);
+  cpl->valid = 0;
+  cq_head = (cq_head + 1) % SQ_LEN;
+}
+
+void accel_batch(const uint8_t *restrict in, uint8_t *restrict out,
+                 size_t jobs) {
+  assert(use_dma);
+
+  size_t submitted = 0, completed = 0;
+  while (completed < jobs) {
+    /* fill the ring and ring the doorbell once for the whole batch */
+    size_t before = submitted;
+    while (submitted < jobs && submitted - completed < SQ_LEN - 1) {
+      size_t slot = submitted % SQ_LEN;
+      memcpy(job_in + slot * JOB_SIZE, in + submitted * JOB_SIZE, JOB_SIZE);
+
+      volatile struct job_desc *d = &sq[sq_tail];
+      d->in_addr = job_in_phys + slot * JOB_SIZE;
+      d->out_addr = job_out_phys + slot * JOB_SIZE;
+      d->job_id = submitted;
+      d->tp_num = tp_num;
+
+      sq_tail = (sq_tail + 1) % SQ_LEN;
+      submitted++;
+    }
+    if (submitted != before) {
+      __sync_synchronize();
+      ACCESS_REG(REG_SQ_TAIL) = sq_tail;
     }
-    
-    // 第二个同步点：等待处理完成
-    pthread_barrier_wait(&barrier);
-    
-    // 等待 DMA 输出完成
-    while (!ACCESS_REG_BYTE(REG_DMA_CTRL_OUT + off))
-        ;
-
-    // 复制结果到对应的输出位置
-    memcpy(t_arg->out + off, dma_out + off, n);
-    
-    return NULL;
+
+    reap_one(out);
+    completed++;
+  }
 }
 
 void accel(const uint8_t * restrict A,
                       uint8_t * restrict out, size_t n) {
-    // 复制输入数据到 DMA 内存
-    memcpy(dma_mem, A, n);
-    ACCESS_REG(REG_TP_NUM) = 2;
-    
-    pthread_t threads[8];
-    thread_arg_t thread_args[8];
-    
-    // 初始化屏障，需要同步 8 个线程
-    pthread_barrier_init(&barrier, NULL, 8);
-    
-    uint64_t total_cycles = 0;
-    uint64_t start = rdtsc();
-    
-    // 创建线程
-    for (int i = 0; i < 8; i++) {
-        thread_args[i].thread_id = i;
-        thread_args[i].A = A;
-        thread_args[i].out = out;
-        thread_args[i].n = n;
-        
-        if (pthread_create(&threads[i], NULL, thread_handler, &thread_args[i]) != 0) {
-            fprintf(stderr, "Error creating thread %d\n", i);
-            // 处理错误
-            return;
-        }
-    }
-    
-    // 等待所有线程完成
-    for (int i = 0; i < 8; i++) {
-        pthread_join(threads[i], NULL);
-    }
-    
-    total_cycles += rdtsc() - start;
-    printf("Cycles per operation: %ld\n", total_cycles);
-    
-    // 销毁屏障
-    pthread_barrier_destroy(&barrier);
-    
-    // 8x8输入
-    // 8x4输出
-    for (int i = 0; i < 8; i++) {
-        fprintf(stderr, "out[%d] = %d\n", i, *(out + i * 32));
-    }
-}
\ No newline at end of file
+    uint8_t in[JOB_SIZE] = {0};
+    uint8_t res[JOB_SIZE];
+
+    // 每一行都是A（与原先8个通道读同一块DMA内存一致）
+    assert(n <= 8);
+    for (int i = 0; i < 8; i++)
+        memcpy(in + i * 8, A, n);
+
+    accel_batch(in, res, 1);
+
+    // 第c列的结果放在out + c * 32
+    for (int c = 0; c < 8; c++)
+        memcpy(out + c * 32, res + c * 8, 8);
+}
@@ -48,6 +48,25 @@ int accelerator_init(bool dma);
 void accel(const uint8_t *restrict A,
                    uint8_t *restrict out, size_t n);
 
+/**
+ * Run a batch of independent 8x8 jobs through the host-memory job queue. The
+ * calling thread keeps the submission ring full and reaps completions as they
+ * arrive, ringing the doorbell once per refill.
+ *
+ * @param in   jobs * 64 bytes of input, one row-major 8x8 matrix per job
+ * @param out  jobs * 64 bytes of output, column c of job j at out[j*64 + c*8]
+ * @param jobs Number of jobs
+ */
+void accel_batch(const uint8_t *restrict in, uint8_t *restrict out,
+                 size_t jobs);
+
+/**
+ * Set the tensor-parallel degree (1, 2, 4 or 8) used for subsequent calls to
+ * accel. Each output row is then reduced on the device from 8 / tp partial
+ * sums of tp products each.
+ */
+void accel_set_tp_num(uint8_t tp);
+
 // Potenitally useful helper
 uint8_t *zero_matrix_alloc(size_t m, size_t n);
 
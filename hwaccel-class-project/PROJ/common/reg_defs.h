@@ -5,37 +5,53 @@
    YOU ARE WELCOME TO CHANGE THIS HOWEVER YOU LIKE!
 */
 
+#include <stdint.h>
 
-/** Control register: used to start the accelerator/wait for completion.
-    read/write */
-#define REG_CTRL 0x00 // RW
+
+/* Register offsets (REG_*) are generated from accel-sim/regs.h, edit them
+   there and run `make common/reg_map.h`. */
+#include "reg_map.h"
 
 /**
+ * REG_CTRL按字节表示每个卡的写入：
  * |Byte 7 |Byte 6|Byte 5 |Byte 4|Byte 3|Byte 2 |Byte 1|Byte 0|
  * |卡7写入|卡6写入|卡5写入|卡4写入|卡3写入|卡2写入|卡1写入|卡0写入|
  */
 
 // IN在0x1000+:0x48
 // OUT在0x2000+:0x40
-#define REG_OFF_IN 0x10 // RO
-#define REG_OFF_OUT 0x20 // RO
-#define REG_TP_NUM 0x30 // RW
-
-
-/** Register holding requested length of the DMA operation in bytes */ // 8B
-#define REG_DMA_LEN  0x40 // RW
-/** Register holding *physical* address on the host. */ // 8B
-#define REG_DMA_ADDR_IN 0x48 // RW
-// 8B
-#define REG_DMA_ADDR_OUT 0x50 // RW
-
-// 2B
-#define REG_DMA_CTRL_IN 0x58 // RW
-// 2B
-#define REG_DMA_CTRL_OUT 0x5A // RO
-
-
 
-// 每个卡28B，留空到32B
+// 每个卡28B，留空到32B（REG_DMA_*_STRIDE）
 // 0x40-0x60 0x60-0x80 0x80-0xA0 0xA0-0xC0 0xC0-0xE0 0xE0-0x100 0x100-0x120 0x120-0x140
-// 最大到0x140
\ No newline at end of file
+// 最大到0x140
+
+/******************************************/
+/* Host-memory job queues */
+
+/** Maximum number of descriptors the device fetches with one DMA read. */
+#define SQ_FETCH_BATCH 8
+
+/** Submission ring entry: one 8x8 job. The input is 64 contiguous bytes (row
+    r at in_addr + 8 * r), the reduced result of column c is written to
+    out_addr + 8 * c (8 / tp_num bytes each). */
+struct job_desc {
+  /** Physical address of the 8x8 input matrix. */
+  uint64_t in_addr;
+  /** Physical address of the 8x8 output buffer. */
+  uint64_t out_addr;
+  /** Job ID specified by SW, reflected in the completion. */
+  uint32_t job_id;
+  /** Tensor-parallel degree for this job (1, 2, 4 or 8). */
+  uint8_t tp_num;
+  uint8_t _pad[11]; /* pad up to 32B */
+} __attribute__((packed));
+
+/** Completion ring entry, written by the device once a job's output is in
+    host memory. SW clears `valid` after consuming the entry. */
+struct job_cpl {
+  /** Job ID reflected from the descriptor. */
+  uint32_t job_id;
+  /** Set to 1 by the device. */
+  uint32_t valid;
+  uint8_t _pad[8]; /* pad up to 16B */
+} __attribute__((packed));
@@ -0,0 +1,24 @@
+from check_common import *
+
+test_name('dma_sweep')
+
+for mtu in [16, 64, 256, 4096]:
+  for credits in [1, 4, 16]:
+    data = load_testfile(f'out/dma_sweep-{mtu}-{credits}-1.json')
+
+    try:
+      out = data['sims']['host.host']['stdout']
+      for tp in [1, 8]:
+        line = find_line(out, f'^TP {tp}: Cycles per operation: ([0-9]*)')
+        if not line:
+          fail(f'Could not find "TP {tp}: Cycles per operation:" output')
+
+        cycles = int(line.group(1))
+        print(f'\033[92m[RESULT HOST]\033[0m  mtu={mtu} credits={credits} '
+              f'tp_num={tp} -> {cycles} Cycles/op')
+    except Exception:
+      exception_thrown()
+      fail('Parsing simulation output failed')
+
+
+success()
@@ -0,0 +1,45 @@
+# DMA SWEEP: Throughput of the job queue as a function of the PCIe DMA model
+# parameters: max payload size per request (MTU) and the number of outstanding
+# request credits. Not part of `make test`, run with `make sweep`.
+
+import sys; sys.path.append('./tests/')
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+
+from hwaccel_common import *
+
+experiments = []
+
+for mtu in [16, 64, 256, 4096]:
+  for credits in [1, 4, 16]:
+    e = exp.Experiment(f'dma_sweep-{mtu}-{credits}')
+    e.checkpoint = True
+
+    server_config = HwAccelNode()
+    server_config.app = AccelApp(8, 10)
+    server_config.nockp = False
+
+    server = sim.Gem5Host(server_config)
+    server.name = 'host'
+    server.cpu_type = 'TimingSimpleCPU'
+    server.cpu_freq = '1GHz'
+
+    hwaccel = HWAccelSim()
+    hwaccel.name = 'accel'
+    hwaccel.sync = True
+    hwaccel.dma_mtu = mtu
+    hwaccel.dma_credits = credits
+
+    server.pci_latency = 100
+    server.sync_period = 100
+
+    hwaccel.pci_latency = 100
+    hwaccel.sync_interval = 100
+
+    server.add_pcidev(hwaccel)
+
+    e.add_pcidev(hwaccel)
+    e.add_host(server)
+    server.wait = True
+
+    experiments.append(e)
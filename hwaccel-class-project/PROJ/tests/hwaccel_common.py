@@ -51,6 +51,12 @@ class HWAccelSim(sim.PCIDevSim):
     pci_latency = 500 # ns
     sync_interval = 500
 
+    # PCIe DMA model parameters, None keeps the simulator default
+    dma_mtu = None        # max payload size per DMA request (bytes, <= 4096)
+    dma_credits = None    # max outstanding DMA requests (<= 256)
+    dma_issue_lat = None  # fixed issue latency per DMA operation (ps)
+    dma_bw = None         # DMA request bandwidth cap (MB/s)
+
     def __init__(self):
         super().__init__()
 
@@ -58,4 +64,13 @@ class HWAccelSim(sim.PCIDevSim):
     def run_cmd(self, env):
         cmd = '%s%s %s %s %d %d' % \
             (os.getcwd(), '/accel-sim/sim', env.dev_pci_path(self), env.dev_shm_path(self), self.pci_latency, self.sync_interval)
-        return cmd
+        return cmd + self.dma_args()
+
+    def dma_args(self):
+        args = ''
+        for opt, val in [('mtu', self.dma_mtu), ('credits', self.dma_credits),
+                         ('issue-lat', self.dma_issue_lat),
+                         ('bw', self.dma_bw)]:
+            if val is not None:
+                args += f' --dma-{opt}={val}'
+        return args
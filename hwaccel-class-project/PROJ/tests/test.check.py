@@ -15,14 +15,20 @@ try:
   print(f'\033[92m[RESULT HOST]\033[0m  {cycles} Cycles/op')
 
   sim_out = data['sims']['dev.host.accel']['stderr']
+  # jobs from the submission ring start once their input has arrived:
+  # QueueStart: job 0 main=17597491001
+  # jobs started through REG_CTRL:
   # MMIO Write: ctrl 1 ex_time=17597496001 main=17597491001
-  start = find_line(sim_out, '^MMIO Write: ctrl 1 ex_time=([0-9]*) main=([0-9]*)')
+  start = find_line(sim_out, '^QueueStart: job [0-9]* main=([0-9]*)')
+  if not start:
+    start = find_line(sim_out,
+                      '^MMIO Write: ctrl 1 ex_time=[0-9]* main=([0-9]*)')
   end = find_line(sim_out, 'DONE  main=([0-9]*)')
   if not start:
-    fail('Could not find CTRL=1')
+    fail('Could not find job start')
   if not end:
     fail('Could not find DONE')
-  start_time = int(start.group(2))
+  start_time = int(start.group(1))
   end_time = int(end.group(1))
   sim_cycles = (end_time - start_time) / 1000 # ns
   print(f'\033[92m[RESULT SIM]\033[0m   {sim_cycles} ns/op')
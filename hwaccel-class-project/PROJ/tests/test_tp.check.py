@@ -0,0 +1,25 @@
+from check_common import *
+
+test_name('test_tp')
+
+data = load_testfile(f'out/test_tp-1.json')
+
+try:
+  out = data['sims']['host.host']['stdout']
+  for tp in [1, 2, 4, 8]:
+    line = find_line(out, f'^TP {tp}: Cycles per operation: ([0-9]*)')
+    if not line:
+      fail(f'Could not find "TP {tp}: Cycles per operation:" output')
+
+    cycles = int(line.group(1))
+    print(f'\033[92m[RESULT HOST]\033[0m  tp_num={tp} -> {cycles} Cycles/op')
+
+    # the reduced output has to match the software reference
+    if not find_line(out, f'^TP {tp}: STATUS: Success matrices match'):
+      fail(f'Output for tp_num={tp} does not match the software reference')
+except Exception:
+  exception_thrown()
+  fail('Parsing simulation output failed')
+
+
+success()
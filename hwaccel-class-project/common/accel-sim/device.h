@@ -0,0 +1,406 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ACCEL_SIM_DEVICE_H_
+#define ACCEL_SIM_DEVICE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <simbricks/pcie/if.h>
+
+#include "dma.h"
+#include "pcie.h"
+#include "regmap.h"
+#include "sched.h"
+#include "stats.h"
+
+namespace accelsim {
+
+/**
+ * Base class for accelerator simulation models (CRTP: `class MyDev : public
+ * Device<MyDev>`). The base runs the SimBricks PCIe connection and the
+ * simulation loop, and provides an event scheduler, the DMA engine and stats
+ * counters. The model customizes it by defining any of these hooks (the
+ * defaults below do nothing):
+ *
+ *   int ParseArgs(int argc, char *argv[]);  positional arguments
+ *   int ParseOption(const char *opt);  other --OPT[=VAL] options
+ *   const char *Usage();
+ *   void Intro(struct SimbricksProtoPcieDevIntro &intro);  PCI ids, BARs
+ *   int OnInit();
+ *   void OnMmioRead(volatile struct SimbricksProtoPcieH2DRead *read);
+ *   void OnMmioWrite(volatile struct SimbricksProtoPcieH2DWrite *write);
+ *   void OnEvent(uint32_t id, uint64_t arg);  events from Schedule
+ *   void OnPoll();  called every loop iteration
+ *   uint64_t OnNextEvent();  next OnPoll deadline, besides scheduled events
+ *   void OnDmaComplete(uint64_t opaque);
+ *   void OnExit();
+ *
+ * The default OnMmioRead/OnMmioWrite dispatch through a register map, which
+ * the model then provides as `static constexpr auto kRegs =
+ * MakeRegMap<kRegInfo, kRegOps>()` (see regmap.h).
+ *
+ * Simulator options handled here, anywhere on the command line:
+ * --dma-OPT=VAL (see DmaEngine::ParseOption) and
+ * --idle-wait=auto|spin|yield|sleep (see IdleBackoff).
+ */
+template <class Derived>
+class Device {
+ public:
+  using Dma = DmaEngine<Device>;
+
+  /** `now` is where the simulation time (in picoseconds) is kept. */
+  explicit Device(uint64_t &now)
+      : now_(now), dma_(*this),
+        mmio_reads_(stats_.Counter("MMIO READS")),
+        mmio_writes_(stats_.Counter("MMIO WRITES")),
+        dma_reads_(stats_.Counter("DMA READS")),
+        dma_writes_(stats_.Counter("DMA WRITES")),
+        interrupts_(stats_.Counter("INTERRUPTS")),
+        loop_iters_(stats_.Counter("RUNLOOP ITERATIONS")),
+        idle_sleeps_(stats_.Counter("IDLE SLEEPS")) {
+  }
+
+  Device() : Device(own_now_) {}
+
+  int Main(int argc, char *argv[]) {
+    if (ParseOptions(argc, argv))
+      return 1;
+
+    if (derived().OnInit())
+      return 1;
+
+    struct SimbricksProtoPcieDevIntro intro;
+    memset(&intro, 0, sizeof(intro));
+    intro.bars[0].len = 1 << 24;
+    intro.bars[0].flags = SIMBRICKS_PROTO_PCIE_BAR_64;
+    intro.pci_vendor_id = 0x9876;
+    intro.pci_device_id = 0x1234;
+    intro.pci_class = 0x40;
+    intro.pci_subclass = 0x00;
+    intro.pci_revision = 0x00;
+    intro.pci_msi_nvecs = 32;
+    derived().Intro(intro);
+
+    if (link_.Connect(shm_path_, intro))
+      return 1;
+
+    RunLoop();
+
+    idle_sleeps_ = link_.backoff.sleeps;
+    stats_.Print(stderr);
+    dma_.PrintStats(stderr);
+    derived().OnExit();
+    return 0;
+  }
+
+  /* Services for the model */
+
+  uint64_t Now() const { return now_; }
+
+  void Schedule(uint64_t time, uint32_t id, uint64_t arg = 0) {
+    sched_.Schedule(time, id, arg);
+  }
+
+  Dma &dma() { return dma_; }
+  Stats &stats() { return stats_; }
+  PcieLink &link() { return link_; }
+
+  volatile union SimbricksProtoPcieD2H *PcieAlloc() {
+    return link_.Alloc(now_);
+  }
+
+  void PcieSend(volatile union SimbricksProtoPcieD2H *msg, uint8_t type) {
+    link_.Send(msg, type);
+  }
+
+  /** Complete an MMIO read with `len` bytes of `data`. */
+  void ReadComplete(volatile struct SimbricksProtoPcieH2DRead *read,
+      const void *data, size_t len) {
+    volatile union SimbricksProtoPcieD2H *msg = PcieAlloc();
+    volatile struct SimbricksProtoPcieD2HReadcomp *rc = &msg->readcomp;
+    rc->req_id = read->req_id;
+    memcpy((void *) rc->data, data, len);
+    PcieSend(msg, SIMBRICKS_PROTO_PCIE_D2H_MSG_READCOMP);
+  }
+
+  /** Send MSI `vector`. Dropped (returns false) while the host has MSI
+   * disabled, e.g. before the driver sets up an interrupt handler. */
+  bool Interrupt(uint16_t vector) {
+    if (!(devctrl_ & SIMBRICKS_PROTO_PCIE_CTRL_MSI_EN))
+      return false;
+    volatile union SimbricksProtoPcieD2H *msg = PcieAlloc();
+    volatile struct SimbricksProtoPcieD2HInterrupt *intr = &msg->interrupt;
+    intr->vector = vector;
+    intr->inttype = SIMBRICKS_PROTO_PCIE_INT_MSI;
+    PcieSend(msg, SIMBRICKS_PROTO_PCIE_D2H_MSG_INTERRUPT);
+    interrupts_++;
+    return true;
+  }
+
+  void DmaComplete(uint64_t opaque) { derived().OnDmaComplete(opaque); }
+
+  /* Default hooks */
+
+  int ParseArgs(int argc, char *argv[]) {
+    return ParseLinkArgs(argc, argv, 1, true);
+  }
+
+  const char *Usage() {
+    return "PCI-SOCKET SHM [START-TICK] [SYNC-PERIOD] [PCI-LATENCY]";
+  }
+
+  int ParseOption(const char *opt) {
+    fprintf(stderr, "unknown option --%s\n", opt);
+    return -1;
+  }
+
+  void Intro(struct SimbricksProtoPcieDevIntro &/*intro*/) {}
+  int OnInit() { return 0; }
+
+  void OnMmioRead(volatile struct SimbricksProtoPcieH2DRead *read) {
+    uint64_t val = 0;
+    if (read->len > sizeof(val) ||
+        !Derived::kRegs.Read(derived(), read->offset, read->len, val)) {
+      fprintf(stderr, "MMIO Read: invalid register %lx len %u\n",
+              (uint64_t) read->offset, (unsigned) read->len);
+    }
+    ReadComplete(read, &val, read->len <= sizeof(val) ? read->len : 0);
+  }
+
+  void OnMmioWrite(volatile struct SimbricksProtoPcieH2DWrite *write) {
+    uint64_t val = 0;
+    if (write->len > sizeof(val)) {
+      fprintf(stderr, "MMIO Write: invalid register %lx len %u\n",
+              (uint64_t) write->offset, (unsigned) write->len);
+      return;
+    }
+    memcpy(&val, (const void *) write->data, write->len);
+    if (!Derived::kRegs.Write(derived(), write->offset, write->len, val)) {
+      fprintf(stderr, "MMIO Write: invalid register %lx len %u\n",
+              (uint64_t) write->offset, (unsigned) write->len);
+    }
+  }
+
+  void OnEvent(uint32_t /*id*/, uint64_t /*arg*/) {}
+  void OnPoll() {}
+  uint64_t OnNextEvent() { return UINT64_MAX; }
+  void OnDmaComplete(uint64_t /*opaque*/) {}
+  void OnExit() {}
+
+ protected:
+  /** Parse PCI-SOCKET SHM [START-TICK] [SYNC-PERIOD] [PCI-LATENCY] (without
+   * START-TICK if `start_tick` is false) from argv[first] on. */
+  int ParseLinkArgs(int argc, char *argv[], int first, bool start_tick) {
+    int n = argc - first;
+    if (n < 2 || n > (start_tick ? 5 : 4))
+      return -1;
+
+    link_.params.sock_path = argv[first];
+    shm_path_ = argv[first + 1];
+    int i = first + 2;
+    if (start_tick && i < argc)
+      now_ = strtoull(argv[i++], NULL, 0);
+    if (i < argc)
+      link_.params.sync_interval = strtoull(argv[i++], NULL, 0) * 1000ULL;
+    if (i < argc)
+      link_.params.link_latency = strtoull(argv[i++], NULL, 0) * 1000ULL;
+    return 0;
+  }
+
+ private:
+  /* unsynchronized mode: step after activity, and max step while idle */
+  static constexpr uint64_t kMinStep = 10000;
+  static constexpr uint64_t kMaxStep = 1000000000;
+
+  Derived &derived() { return static_cast<Derived &>(*this); }
+
+  int ParseOptions(int argc, char *argv[]) {
+    // strip options (--dma-*, --idle-wait=, and the model's) before the
+    // positional arguments
+    int i, j;
+    bool err = false;
+    for (i = 1, j = 1; i < argc; i++) {
+      if (!strncmp(argv[i], "--dma-", 6)) {
+        err = err || dma_.ParseOption(argv[i] + 6);
+      } else if (!strncmp(argv[i], "--idle-wait=", 12)) {
+        err = err || link_.backoff.Parse(argv[i] + 12);
+      } else if (!strncmp(argv[i], "--", 2)) {
+        err = err || derived().ParseOption(argv[i] + 2);
+      } else {
+        argv[j++] = argv[i];
+      }
+    }
+    argc = j;
+
+    if (err || derived().ParseArgs(argc, argv)) {
+      fprintf(stderr, "Usage: accel-sim [--dma-OPT=VAL]... [--idle-wait=MODE] "
+              "%s\n", derived().Usage());
+      return -1;
+    }
+    return 0;
+  }
+
+  bool PollPcie() {
+    volatile union SimbricksProtoPcieH2D *msg =
+        SimbricksPcieIfH2DInPoll(&link_.pcie_if, now_);
+    uint8_t type;
+
+    if (msg == NULL)
+      return false;
+
+    type = SimbricksPcieIfH2DInType(&link_.pcie_if, msg);
+    switch (type) {
+      case SIMBRICKS_PROTO_PCIE_H2D_MSG_READ:
+        mmio_reads_++;
+        derived().OnMmioRead(&msg->read);
+        break;
+
+      case SIMBRICKS_PROTO_PCIE_H2D_MSG_WRITE: {
+        mmio_writes_++;
+        derived().OnMmioWrite(&msg->write);
+
+        volatile union SimbricksProtoPcieD2H *omsg = PcieAlloc();
+        volatile struct SimbricksProtoPcieD2HWritecomp *wc = &omsg->writecomp;
+        wc->req_id = msg->write.req_id;
+        PcieSend(omsg, SIMBRICKS_PROTO_PCIE_D2H_MSG_WRITECOMP);
+        break;
+      }
+
+      case SIMBRICKS_PROTO_PCIE_H2D_MSG_WRITE_POSTED:
+        mmio_writes_++;
+        derived().OnMmioWrite(&msg->write);
+        break;
+
+      case SIMBRICKS_PROTO_PCIE_H2D_MSG_READCOMP:
+        dma_reads_++;
+        dma_.Complete(msg, type);
+        break;
+
+      case SIMBRICKS_PROTO_PCIE_H2D_MSG_WRITECOMP:
+        dma_writes_++;
+        dma_.Complete(msg, type);
+        break;
+
+      case SIMBRICKS_PROTO_PCIE_H2D_MSG_DEVCTRL:
+        devctrl_ = msg->devctrl.flags;
+        break;
+
+      case SIMBRICKS_PROTO_MSG_TYPE_SYNC:
+        break;
+
+      case SIMBRICKS_PROTO_MSG_TYPE_TERMINATE:
+        fprintf(stderr, "poll_h2d: peer terminated\n");
+        exiting_ = true;
+        break;
+
+      default:
+        fprintf(stderr, "poll_h2d: unsupported type=%u\n", type);
+    }
+
+    SimbricksPcieIfH2DInDone(&link_.pcie_if, msg);
+    return true;
+  }
+
+  void RunLoop() {
+    struct SimbricksPcieIf *pcie_if = &link_.pcie_if;
+    uint64_t next_ts, next_sync, next_in, next_ev, t;
+    uint64_t step = kMinStep;
+    uint64_t idle = 0;
+    EventScheduler::Event ev;
+    bool active;
+
+    while (!exiting_) {
+      while (SimbricksPcieIfD2HOutSync(pcie_if, now_))
+        link_.backoff.Wait(idle++);
+
+      do {
+        loop_iters_++;
+        active = PollPcie();
+        while (sched_.PopDue(now_, ev))
+          derived().OnEvent(ev.id, ev.arg);
+        derived().OnPoll();
+        dma_.Poll();
+
+        next_ev = sched_.Next();
+        if ((t = derived().OnNextEvent()) < next_ev)
+          next_ev = t;
+        if ((t = dma_.NextEvent()) < next_ev)
+          next_ev = t;
+
+        if (link_.sync) {
+          // nothing can happen before the next message arrives or a sync is
+          // due
+          next_in = SimbricksPcieIfH2DInTimestamp(pcie_if);
+          next_sync = SimbricksPcieIfD2HOutNextSync(pcie_if);
+          next_ts = (next_in <= next_sync ? next_in : next_sync);
+        } else {
+          // fine-grained steps while busy, exponentially larger ones when idle
+          if (active || next_ev != UINT64_MAX)
+            step = kMinStep;
+          else if (step < kMaxStep)
+            step *= 2;
+          next_ts = now_ + step;
+        }
+
+        if (next_ev < next_ts)
+          next_ts = next_ev;
+
+        if (active || next_ev <= now_)
+          idle = 0;
+        else if (next_ts <= now_ || (!link_.sync && next_ev == UINT64_MAX))
+          link_.backoff.Wait(idle++);
+      } while (next_ts <= now_ && !exiting_);
+
+      now_ = next_ts;
+    }
+  }
+
+  uint64_t own_now_ = 0;
+  uint64_t &now_;
+  const char *shm_path_ = nullptr;
+  volatile bool exiting_ = false;
+  /* interrupt enables from the host (SIMBRICKS_PROTO_PCIE_CTRL_*) */
+  uint64_t devctrl_ = 0;
+
+  PcieLink link_;
+  EventScheduler sched_;
+  Dma dma_;
+
+  Stats stats_;
+  uint64_t &mmio_reads_;
+  uint64_t &mmio_writes_;
+  uint64_t &dma_reads_;
+  uint64_t &dma_writes_;
+  uint64_t &interrupts_;
+  uint64_t &loop_iters_;
+  uint64_t &idle_sleeps_;
+};
+
+}  // namespace accelsim
+
+#endif  // ndef ACCEL_SIM_DEVICE_H_
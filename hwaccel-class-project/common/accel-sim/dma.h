@@ -0,0 +1,484 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ACCEL_SIM_DMA_H_
+#define ACCEL_SIM_DMA_H_
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <simbricks/pcie/proto.h>
+
+namespace accelsim {
+
+/**
+ * DMA engine. Two key constraints:
+ * 1) no individual DMA op must be larger than the max payload size (default
+ * 4KB), i.e. we have to split larger transfers.
+ * 2) No more than 16 (default) pending DMA operations at a time (approximates
+ * PCIe flow control).
+ * Both limits, plus an optional fixed issue latency per operation and a cap on
+ * the bandwidth at which requests leave the device, can be set on the
+ * simulator command line with --dma-* options (see ParseOption).
+ *
+ * All state lives in fixed-size slabs, so issuing and completing operations
+ * never allocates. The PCIe req_id of a sub-operation encodes its slab index
+ * and a generation counter, completions are matched up in O(1) and may arrive
+ * in any order.
+ *
+ * Operations are queued on one of kNumQueues issue queues (by default reads
+ * and writes go to separate queues). Whenever a credit is free, the arbiter
+ * picks the next sub-operation from the non-empty queue with the highest
+ * priority, queues of equal priority share the credits in weighted
+ * round-robin. Per-queue op counts and latencies are tracked.
+ *
+ * `Owner` provides the PCIe link and gets the completions:
+ *   uint64_t Now();
+ *   volatile union SimbricksProtoPcieD2H *PcieAlloc();
+ *   void PcieSend(volatile union SimbricksProtoPcieD2H *msg, uint8_t type);
+ *   void DmaComplete(uint64_t opaque);
+ */
+template <class Owner>
+class DmaEngine {
+ public:
+  static constexpr unsigned kNumQueues = 4;
+  static constexpr unsigned kQueueRead = 0;
+  static constexpr unsigned kQueueWrite = 1;
+  /** Upper bounds for the runtime max payload size and credit limit. */
+  static constexpr size_t kMaxOpSize = 4096;
+  static constexpr size_t kMaxPending = 256;
+  /** Maximum number of DMA operations (issued with Read/Write) in flight. */
+  static constexpr size_t kMaxOps = 256;
+
+  explicit DmaEngine(Owner &owner) : owner_(owner) {
+    size_t i;
+    for (i = 0; i < kMaxOps; i++)
+      ops_free_[i] = kMaxOps - 1 - i;
+    n_ops_free_ = kMaxOps;
+    for (i = 0; i < kMaxPending; i++)
+      sops_free_[i] = kMaxPending - 1 - i;
+  }
+
+  void Read(void *dst, uint64_t src_addr, size_t len, uint64_t opaque,
+      unsigned queue = kQueueRead) {
+    Issue(queue, dst, src_addr, len, opaque, false);
+  }
+
+  void Write(uint64_t dst_addr, const void *src, size_t len, uint64_t opaque,
+      unsigned queue = kQueueWrite) {
+    Issue(queue, const_cast<void *>(src), dst_addr, len, opaque, true);
+  }
+
+  /**
+   * Configure arbitration for a queue. Pending credits go to the non-empty
+   * queues with the highest priority first, queues with the same priority take
+   * turns issuing up to `weight` sub-operations each. All queues start with
+   * priority 0 and weight 1.
+   */
+  void QueueConfig(unsigned queue, unsigned prio, unsigned weight) {
+    if (queue >= kNumQueues || weight == 0) {
+      fprintf(stderr, "DmaEngine: invalid queue %u / weight %u\n", queue,
+              weight);
+      abort();
+    }
+    queues_[queue].prio = prio;
+    queues_[queue].weight = weight;
+  }
+
+  /** Handle a PCIe read or write completion for one of our requests. */
+  void Complete(volatile union SimbricksProtoPcieH2D *msg, uint8_t type) {
+    uint64_t req_id;
+    if (type == SIMBRICKS_PROTO_PCIE_H2D_MSG_READCOMP) {
+      req_id = msg->readcomp.req_id;
+    } else if (type == SIMBRICKS_PROTO_PCIE_H2D_MSG_WRITECOMP) {
+      req_id = msg->writecomp.req_id;
+    } else {
+      fprintf(stderr, "DmaEngine: unexpected event (%u)\n", type);
+      abort();
+    }
+
+    uint32_t sop_idx = (uint32_t) req_id;
+    assert(sop_idx < kMaxPending);
+    SubOp *sop = &sops_[sop_idx];
+    assert(sop->gen == (uint32_t) (req_id >> 32));
+    Op *op = &ops_[sop->op];
+
+    if (type == SIMBRICKS_PROTO_PCIE_H2D_MSG_READCOMP) {
+      // Complete a read, involves also copying the data
+      memcpy((uint8_t *) op->ptr + sop->offset, (void *) msg->readcomp.data,
+        sop->len);
+    }
+
+    assert(n_pending_ > 0);
+    n_pending_--;
+    sops_free_[kMaxPending - 1 - n_pending_] = sop_idx;
+
+    assert(op->n_pending > 0);
+    op->n_pending--;
+    if (op->n_pending == 0 && op->issue_offset == op->len) {
+      // Operation is now done, yay!
+      uint64_t opaque = op->opaque;
+      OpDone(op);
+      ops_free_[n_ops_free_++] = sop->op;
+
+      owner_.DmaComplete(opaque);
+    }
+
+    IssuePending();
+  }
+
+  /** Move operations along that were waiting for time to pass. */
+  void Poll() {
+    uint64_t now = owner_.Now();
+    while (delay_head_ != delay_tail_) {
+      uint32_t op_idx = delay_q_[delay_head_ % kMaxOps];
+      Op *op = &ops_[op_idx];
+      if (op->issue_time + issue_lat_ > now)
+        break;
+
+      Enqueue(op_idx);
+      delay_head_++;
+    }
+
+    IssuePending();
+  }
+
+  /** Time of the next event (see Poll) or UINT64_MAX. */
+  uint64_t NextEvent() const {
+    uint64_t next = UINT64_MAX;
+    unsigned i;
+
+    if (delay_head_ != delay_tail_)
+      next = ops_[delay_q_[delay_head_ % kMaxOps]].issue_time + issue_lat_;
+
+    if (link_free_ > owner_.Now() && n_pending_ < credits_ &&
+        link_free_ < next) {
+      for (i = 0; i < kNumQueues; i++) {
+        if (!QueueEmpty(queues_[i])) {
+          next = link_free_;
+          break;
+        }
+      }
+    }
+    return next;
+  }
+
+  /**
+   * Parse a model option, with the "--dma-" prefix already stripped:
+   * mtu=BYTES, credits=N, issue-lat=PS, bw=MB/S. Returns 0 on success.
+   */
+  int ParseOption(const char *opt) {
+    const char *val = strchr(opt, '=');
+    if (!val)
+      return OptError(opt);
+    uint64_t v = strtoull(val + 1, NULL, 0);
+    size_t len = val - opt;
+
+    if (len == 3 && !strncmp(opt, "mtu", len) && v > 0 && v <= kMaxOpSize) {
+      op_size_ = v;
+    } else if (len == 7 && !strncmp(opt, "credits", len) && v > 0 &&
+        v <= kMaxPending) {
+      credits_ = v;
+    } else if (len == 9 && !strncmp(opt, "issue-lat", len)) {
+      issue_lat_ = v;
+    } else if (len == 2 && !strncmp(opt, "bw", len)) {
+      bw_ = v;
+    } else {
+      return OptError(opt);
+    }
+    return 0;
+  }
+
+  void ResetStats() {
+    for (Queue &q : queues_) {
+      q.ops = q.bytes = q.lat_sum = q.lat_max = 0;
+      memset(q.lat_hist, 0, sizeof(q.lat_hist));
+    }
+  }
+
+  /** Print the configuration and per-queue op counts and latencies. */
+  void PrintStats(FILE *f) const {
+    fprintf(f, "DMA CONFIG: mtu=%zu credits=%zu issue-lat=%lups bw=%luMB/s\n",
+            op_size_, credits_, issue_lat_, bw_);
+    for (unsigned i = 0; i < kNumQueues; i++) {
+      const Queue &q = queues_[i];
+      if (q.ops == 0)
+        continue;
+      fprintf(f, "DMA Q%u: ops=%lu bytes=%lu lat avg=%.1fns p50=%.1fns "
+              "p99=%.1fns max=%.1fns\n", i, q.ops, q.bytes,
+              q.lat_sum / 1000.0 / q.ops, LatPercentile(q, 50) / 1000.0,
+              LatPercentile(q, 99) / 1000.0, q.lat_max / 1000.0);
+    }
+  }
+
+ private:
+  /* latency histogram (picoseconds), 2^kLatSubBits buckets per power of two,
+   * i.e. percentiles are accurate to about 6% */
+  static constexpr unsigned kLatSubBits = 4;
+  static constexpr unsigned kLatBuckets = (65 - kLatSubBits) << kLatSubBits;
+
+  struct Op {
+    uint64_t addr;
+    void *ptr;
+    uint64_t len;
+    uint64_t issue_offset;
+    uint64_t opaque;
+    uint64_t n_pending;
+    uint64_t issue_time;
+    uint8_t queue;
+    bool write;
+  };
+
+  struct SubOp {
+    uint32_t op;
+    uint32_t gen;
+    uint64_t offset;
+    uint16_t len;
+  };
+
+  struct Queue {
+    /* ring of op indices that still have bytes left to issue, in FIFO
+     * order */
+    uint32_t ring[kMaxOps];
+    size_t head = 0;
+    size_t tail = 0;
+    unsigned prio = 0;
+    unsigned weight = 1;
+
+    uint64_t ops = 0;
+    uint64_t bytes = 0;
+    uint64_t lat_sum = 0;
+    uint64_t lat_max = 0;
+    uint64_t lat_hist[kLatBuckets] = {};
+  };
+
+  static bool QueueEmpty(const Queue &q) {
+    return q.head == q.tail;
+  }
+
+  /* Returns the queue to issue the next sub-operation from, or -1 if there
+   * is nothing left to issue. */
+  int PickQueue() {
+    Queue *best = nullptr;
+    unsigned i;
+    for (i = 0; i < kNumQueues; i++) {
+      if (!QueueEmpty(queues_[i]) && (!best || queues_[i].prio > best->prio))
+        best = &queues_[i];
+    }
+    if (!best)
+      return -1;
+
+    Queue &cur = queues_[rr_queue_];
+    if (rr_left_ > 0 && !QueueEmpty(cur) && cur.prio == best->prio) {
+      rr_left_--;
+      return rr_queue_;
+    }
+
+    for (i = 1; i <= kNumQueues; i++) {
+      unsigned q = (rr_queue_ + i) % kNumQueues;
+      if (!QueueEmpty(queues_[q]) && queues_[q].prio == best->prio) {
+        rr_queue_ = q;
+        rr_left_ = queues_[q].weight - 1;
+        return q;
+      }
+    }
+    abort();
+  }
+
+  static unsigned LatBucket(uint64_t lat) {
+    const unsigned n = 1 << kLatSubBits;
+    if (lat < n)
+      return lat;
+    unsigned msb = 63 - __builtin_clzll(lat);
+    return (msb - kLatSubBits + 1) * n +
+        ((lat >> (msb - kLatSubBits)) & (n - 1));
+  }
+
+  /* lower bound of the latencies counted in bucket b */
+  static uint64_t LatBucketValue(unsigned b) {
+    const unsigned n = 1 << kLatSubBits;
+    if (b < n)
+      return b;
+    return (uint64_t) (n + b % n) << (b / n - 1);
+  }
+
+  static uint64_t LatPercentile(const Queue &q, unsigned pct) {
+    uint64_t target = (q.ops * pct + 99) / 100;
+    uint64_t sum = 0;
+    for (unsigned b = 0; b < kLatBuckets; b++) {
+      sum += q.lat_hist[b];
+      if (sum >= target)
+        return LatBucketValue(b);
+    }
+    return q.lat_max;
+  }
+
+  void OpDone(Op *op) {
+    Queue &q = queues_[op->queue];
+    uint64_t lat = owner_.Now() - op->issue_time;
+    q.ops++;
+    q.bytes += op->len;
+    q.lat_sum += lat;
+    if (lat > q.lat_max)
+      q.lat_max = lat;
+    q.lat_hist[LatBucket(lat)]++;
+  }
+
+  uint64_t SubOpReqId(uint32_t idx) const {
+    return ((uint64_t) sops_[idx].gen << 32) | idx;
+  }
+
+  void IssuePending() {
+    int q_idx;
+    while (n_pending_ < credits_ && owner_.Now() >= link_free_ &&
+        (q_idx = PickQueue()) >= 0) {
+      Queue &q = queues_[q_idx];
+      uint32_t op_idx = q.ring[q.head % kMaxOps];
+      Op *op = &ops_[op_idx];
+
+      size_t len = op->len - op->issue_offset;
+      if (len > op_size_)
+        len = op_size_;
+
+      // n_pending bounds the number of sub-ops, so there is always one free
+      uint32_t sop_idx = sops_free_[kMaxPending - 1 - n_pending_];
+      SubOp *sop = &sops_[sop_idx];
+      sop->op = op_idx;
+      sop->gen++;
+      sop->offset = op->issue_offset;
+      sop->len = len;
+
+      volatile union SimbricksProtoPcieD2H *msg = owner_.PcieAlloc();
+      if (op->write) {
+        volatile struct SimbricksProtoPcieD2HWrite *w = &msg->write;
+        w->req_id = SubOpReqId(sop_idx);
+        w->offset = op->addr + op->issue_offset;
+        w->len = len;
+        memcpy((void *) w->data, ((uint8_t *) (op->ptr)) + op->issue_offset,
+               len);
+
+        owner_.PcieSend(msg, SIMBRICKS_PROTO_PCIE_D2H_MSG_WRITE);
+      } else {
+        volatile struct SimbricksProtoPcieD2HRead *r = &msg->read;
+        r->req_id = SubOpReqId(sop_idx);
+        r->offset = op->addr + op->issue_offset;
+        r->len = len;
+
+        owner_.PcieSend(msg, SIMBRICKS_PROTO_PCIE_D2H_MSG_READ);
+      }
+
+      op->n_pending++;
+      op->issue_offset += len;
+      n_pending_++;
+      if (bw_)
+        link_free_ = owner_.Now() + len * 1000000ULL / bw_;
+
+      if (op->issue_offset >= op->len)
+        q.head++;
+    }
+  }
+
+  void Enqueue(uint32_t op_idx) {
+    Queue &q = queues_[ops_[op_idx].queue];
+    q.ring[q.tail % kMaxOps] = op_idx;
+    q.tail++;
+  }
+
+  void Issue(unsigned queue, void *ptr, uint64_t addr, size_t len,
+      uint64_t opaque, bool write) {
+    if (queue >= kNumQueues) {
+      fprintf(stderr, "DmaEngine: invalid queue %u\n", queue);
+      abort();
+    }
+
+    if (n_ops_free_ == 0) {
+      fprintf(stderr, "DmaEngine: more than %zu DMA operations in flight\n",
+              kMaxOps);
+      abort();
+    }
+
+    uint32_t op_idx = ops_free_[--n_ops_free_];
+    Op *op = &ops_[op_idx];
+    op->addr = addr;
+    op->ptr = ptr;
+    op->len = len;
+    op->issue_offset = 0;
+    op->opaque = opaque;
+    op->n_pending = 0;
+    op->issue_time = owner_.Now();
+    op->queue = queue;
+    op->write = write;
+
+    if (issue_lat_) {
+      delay_q_[delay_tail_ % kMaxOps] = op_idx;
+      delay_tail_++;
+      return;
+    }
+
+    Enqueue(op_idx);
+    IssuePending();
+  }
+
+  int OptError(const char *opt) {
+    fprintf(stderr, "DmaEngine: invalid option --dma-%s (expected "
+            "mtu=1..%zu, credits=1..%zu, issue-lat=PS, bw=MB/S)\n", opt,
+            kMaxOpSize, kMaxPending);
+    return -1;
+  }
+
+  Owner &owner_;
+
+  Op ops_[kMaxOps];
+  uint32_t ops_free_[kMaxOps];
+  size_t n_ops_free_ = 0;
+
+  SubOp sops_[kMaxPending] = {};
+  uint32_t sops_free_[kMaxPending];
+  size_t n_pending_ = 0;
+
+  Queue queues_[kNumQueues];
+  /* queue currently served by round-robin and sub-ops it may still issue */
+  unsigned rr_queue_ = 0;
+  unsigned rr_left_ = 0;
+
+  /* operations waiting out the issue latency before being queued, in order */
+  uint32_t delay_q_[kMaxOps];
+  size_t delay_head_ = 0;
+  size_t delay_tail_ = 0;
+
+  /* model parameters */
+  size_t op_size_ = kMaxOpSize;
+  size_t credits_ = 16;
+  uint64_t issue_lat_ = 0; /* picoseconds */
+  uint64_t bw_ = 0; /* MB/s, 0 = unlimited */
+  /* with a bandwidth cap: earliest time the next request may leave */
+  uint64_t link_free_ = 0;
+};
+
+}  // namespace accelsim
+
+#endif  // ndef ACCEL_SIM_DMA_H_
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Framework side of the C callback interface, see legacy.h. Models without
+ * DMA need not define DMACompleteEvent.
+ */
+
+#include "legacy.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <simbricks/pcie/if.h>
+
+#include "device.h"
+
+/* the model's callbacks, as declared in the milestones' accel-sim/sim.h */
+extern "C" {
+int InitState(void);
+void MMIORead(volatile struct SimbricksProtoPcieH2DRead *read);
+void MMIOWrite(volatile struct SimbricksProtoPcieH2DWrite *write);
+void PollEvent(void);
+uint64_t NextEvent(void);
+void DMACompleteEvent(uint64_t opaque) __attribute__((weak));
+}
+
+extern "C" {
+uint64_t main_time = 0;
+}
+
+namespace accelsim {
+
+class LegacyDevice : public Device<LegacyDevice> {
+ public:
+  explicit LegacyDevice(const LegacyConfig &cfg)
+      : Device(main_time), cfg_(cfg) {
+    usage_[0] = 0;
+    snprintf(usage_, sizeof(usage_), "%s%s%s", cfg_.usage ? cfg_.usage : "",
+             cfg_.usage ? " " : "",
+             cfg_.start_tick ?
+                 "PCI-SOCKET SHM [START-TICK] [SYNC-PERIOD] [PCI-LATENCY]" :
+                 "PCI-SOCKET SHM [SYNC-PERIOD] [PCI-LATENCY]");
+  }
+
+  int ParseArgs(int argc, char *argv[]) {
+    int first = 1 + cfg_.n_params;
+    if (argc < first)
+      return -1;
+    for (size_t i = 0; i < cfg_.n_params; i++)
+      *cfg_.params[i] = strtoull(argv[1 + i], NULL, 0);
+    return ParseLinkArgs(argc, argv, first, cfg_.start_tick);
+  }
+
+  const char *Usage() { return usage_; }
+
+  int ParseOption(const char *opt) {
+    if (cfg_.parse_option)
+      return cfg_.parse_option(opt);
+    return Device::ParseOption(opt);
+  }
+
+  int OnInit() { return InitState(); }
+
+  void OnMmioRead(volatile struct SimbricksProtoPcieH2DRead *read) {
+    MMIORead(read);
+  }
+
+  void OnMmioWrite(volatile struct SimbricksProtoPcieH2DWrite *write) {
+    MMIOWrite(write);
+  }
+
+  void OnPoll() { PollEvent(); }
+  uint64_t OnNextEvent() { return NextEvent(); }
+
+  void OnDmaComplete(uint64_t opaque) {
+    if (DMACompleteEvent)
+      DMACompleteEvent(opaque);
+  }
+
+  void OnExit() {
+    if (cfg_.finalize)
+      cfg_.finalize();
+  }
+
+ private:
+  const LegacyConfig &cfg_;
+  char usage_[256];
+};
+
+static LegacyDevice *legacy_dev;
+
+int LegacyMain(int argc, char *argv[], const LegacyConfig &cfg) {
+  LegacyDevice dev(cfg);
+  legacy_dev = &dev;
+  return dev.Main(argc, argv);
+}
+
+}  // namespace accelsim
+
+extern "C" {
+
+volatile union SimbricksProtoPcieD2H *AllocPcieOut(void) {
+  return accelsim::legacy_dev->PcieAlloc();
+}
+
+void SendPcieOut(volatile union SimbricksProtoPcieD2H *msg, uint64_t type) {
+  accelsim::legacy_dev->PcieSend(msg, type);
+}
+
+void IssueDMARead(void *dst, uint64_t src_addr, size_t len, uint64_t opaque) {
+  accelsim::legacy_dev->dma().Read(dst, src_addr, len, opaque);
+}
+
+void IssueDMAWrite(uint64_t dst_addr, const void *src, size_t len,
+    uint64_t opaque) {
+  accelsim::legacy_dev->dma().Write(dst_addr, src, len, opaque);
+}
+
+void IssueDMAReadQ(unsigned queue, void *dst, uint64_t src_addr, size_t len,
+    uint64_t opaque) {
+  accelsim::legacy_dev->dma().Read(dst, src_addr, len, opaque, queue);
+}
+
+void IssueDMAWriteQ(unsigned queue, uint64_t dst_addr, const void *src,
+    size_t len, uint64_t opaque) {
+  accelsim::legacy_dev->dma().Write(dst_addr, src, len, opaque, queue);
+}
+
+void DMAQueueConfig(unsigned queue, unsigned prio, unsigned weight) {
+  accelsim::legacy_dev->dma().QueueConfig(queue, prio, weight);
+}
+
+int IssueMSI(uint16_t vector) {
+  return accelsim::legacy_dev->Interrupt(vector) ? 0 : -1;
+}
+
+}  // extern "C"
+
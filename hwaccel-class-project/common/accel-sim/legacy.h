@@ -0,0 +1,62 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ACCEL_SIM_LEGACY_H_
+#define ACCEL_SIM_LEGACY_H_
+
+/*
+ * Adapter for models written against the C callback interface in the
+ * milestones' accel-sim/sim.h (InitState, MMIORead, MMIOWrite, PollEvent,
+ * NextEvent, DMACompleteEvent). legacy.cc provides that interface's framework
+ * side (main_time, AllocPcieOut, SendPcieOut, IssueDMA*, DMAQueueConfig,
+ * IssueMSI) on top of Device; link it into the simulator and call LegacyMain
+ * from main().
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace accelsim {
+
+struct LegacyConfig {
+  /** Positional arguments before PCI-SOCKET, e.g. "OP-LATENCY MATRIX-SIZE" */
+  const char *usage;
+  /** Where to store the values of those arguments */
+  uint64_t *params[4];
+  size_t n_params;
+  /** Whether START-TICK follows SHM */
+  bool start_tick;
+  /** Called once before exiting, may be NULL */
+  void (*finalize)(void);
+  /** Parses model options (--OPT[=VAL], without the --) not handled by the
+   * framework, returns 0 on success. May be NULL. */
+  int (*parse_option)(const char *opt);
+};
+
+/** Run the simulator for the model's C callbacks. */
+int LegacyMain(int argc, char *argv[], const LegacyConfig &cfg);
+
+}  // namespace accelsim
+
+#endif  // ndef ACCEL_SIM_LEGACY_H_
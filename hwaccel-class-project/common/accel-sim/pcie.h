@@ -0,0 +1,206 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ACCEL_SIM_PCIE_H_
+#define ACCEL_SIM_PCIE_H_
+
+#include <sched.h>
+#include <time.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <simbricks/pcie/if.h>
+
+namespace accelsim {
+
+/**
+ * Waiting policy when the simulator has nothing to do but wait for the peer.
+ * The peer never signals us, so there is nothing to block on; instead we back
+ * off from spinning to yielding to sleeping. By default a synchronized link
+ * spins (the peer is only ever a few sync periods ahead, so sleeping mostly
+ * adds wakeup latency) and an unsynchronized one yields; sleeping is opt-in.
+ */
+class IdleBackoff {
+ public:
+  enum Mode {
+    kAuto,
+    kSpin,
+    kYield,
+    kSleep,
+  };
+
+  /** Parse a --idle-wait= value (auto, spin, yield, or sleep). */
+  int Parse(const char *mode) {
+    if (!strcmp(mode, "auto")) {
+      mode_ = kAuto;
+    } else if (!strcmp(mode, "spin")) {
+      mode_ = kSpin;
+    } else if (!strcmp(mode, "yield")) {
+      mode_ = kYield;
+    } else if (!strcmp(mode, "sleep")) {
+      mode_ = kSleep;
+    } else {
+      fprintf(stderr, "invalid --idle-wait=%s (auto, spin, yield, or sleep)\n",
+              mode);
+      return -1;
+    }
+    return 0;
+  }
+
+  /** Pick the mode for kAuto once we know whether the link is synchronized. */
+  void Resolve(bool sync) {
+    if (mode_ == kAuto)
+      mode_ = sync ? kSpin : kYield;
+  }
+
+  /* n counts consecutive idle iterations, starting at 0: spin for the first
+   * 20us, then yield the CPU until 100us, and after that sleep for 1/16th of
+   * the time we have been idle so far (at most 1ms). This bounds the added
+   * wakeup latency to ~6% of the idle period. */
+  void Wait(uint64_t n) {
+    struct timespec now;
+
+    if (mode_ == kSpin)
+      return;
+
+    if (n == 0) {
+      clock_gettime(CLOCK_MONOTONIC, &start_);
+      return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t idle_ns = (now.tv_sec - start_.tv_sec) * 1000000000ULL +
+        now.tv_nsec - start_.tv_nsec;
+    if (idle_ns < 20000)
+      return;
+
+    if (mode_ == kYield || idle_ns < 100000) {
+      sched_yield();
+      return;
+    }
+
+    uint64_t sleep_ns = idle_ns / 16;
+    if (sleep_ns > 1000000)
+      sleep_ns = 1000000;
+    struct timespec ts = {0, (long) sleep_ns};
+    sleeps++;
+    nanosleep(&ts, NULL);
+  }
+
+  uint64_t sleeps = 0;
+
+ private:
+  Mode mode_ = kAuto;
+  struct timespec start_;
+};
+
+/** The SimBricks PCIe connection of a device simulator. */
+class PcieLink {
+ public:
+  PcieLink() {
+    SimbricksPcieIfDefaultParams(&params);
+  }
+
+  /** Connect to the host: listen on params.sock_path, create the shared
+   * memory pool at `shm_path`, and exchange the intro messages. */
+  int Connect(const char *shm_path,
+      const struct SimbricksProtoPcieDevIntro &intro) {
+    struct SimbricksBaseIfSHMPool pool;
+
+    size_t shm_size = SimbricksBaseIfSHMSize(&params);
+    if (SimbricksBaseIfSHMPoolCreate(&pool, shm_path, shm_size)) {
+      perror("SimbricksBaseIfSHMPoolCreate failed");
+      return -1;
+    }
+
+    if (SimbricksBaseIfInit(&pcie_if.base, &params)) {
+      perror("SimbricksBaseIfInit failed");
+      return -1;
+    }
+
+    if (SimbricksBaseIfListen(&pcie_if.base, &pool)) {
+      perror("SimbricksBaseIfListen failed");
+      return -1;
+    }
+
+    struct SimbricksProtoPcieDevIntro d_intro = intro;
+    struct SimbricksProtoPcieHostIntro h_intro;
+
+    struct SimBricksBaseIfEstablishData estd;
+    estd.base_if = &pcie_if.base;
+    estd.tx_intro = &d_intro;
+    estd.tx_intro_len = sizeof(d_intro);
+    estd.rx_intro = &h_intro;
+    estd.rx_intro_len = sizeof(h_intro);
+
+    if (SimBricksBaseIfEstablish(&estd, 1)) {
+      perror("SimBricksBaseIfEstablish failed");
+      return -1;
+    }
+
+    sync = SimbricksBaseIfSyncEnabled(&pcie_if.base);
+    backoff.Resolve(sync);
+    return 0;
+  }
+
+  volatile union SimbricksProtoPcieD2H *Alloc(uint64_t now) {
+    if (SimbricksBaseIfInTerminated(&pcie_if.base)) {
+      fprintf(stderr, "AllocPcieOut: peer already terminated\n");
+      abort();
+    }
+
+    volatile union SimbricksProtoPcieD2H *msg;
+    bool first = true;
+    uint64_t n = 0;
+    while ((msg = SimbricksPcieIfD2HOutAlloc(&pcie_if, now)) == NULL) {
+      backoff.Wait(n++);
+      if (first) {
+        fprintf(stderr, "AllocPcieOut: warning waiting for entry (%zu)\n",
+                pcie_if.base.out_pos);
+        first = false;
+      }
+    }
+
+    if (!first)
+      fprintf(stderr, "AllocPcieOut: entry successfully allocated\n");
+
+    return msg;
+  }
+
+  void Send(volatile union SimbricksProtoPcieD2H *msg, uint8_t type) {
+    SimbricksPcieIfD2HOutSend(&pcie_if, msg, type);
+  }
+
+  struct SimbricksBaseIfParams params;
+  struct SimbricksPcieIf pcie_if;
+  bool sync = false;
+  IdleBackoff backoff;
+};
+
+}  // namespace accelsim
+
+#endif  // ndef ACCEL_SIM_PCIE_H_
@@ -0,0 +1,317 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ACCEL_SIM_REGMAP_H_
+#define ACCEL_SIM_REGMAP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+
+namespace accelsim {
+
+enum class Access : uint8_t {
+  kRO,
+  kWO,
+  kRW,
+};
+
+/**
+ * Layout of one MMIO register, or of `count` registers `stride` bytes apart
+ * (a register array, e.g. one per channel). The layout is the single source
+ * for both the simulator's dispatch (RegMap) and the driver's C header
+ * (PrintCHeader).
+ */
+struct RegInfo {
+  const char *name;
+  uint64_t offset;
+  uint8_t width;  /* bytes, 1..8 */
+  Access access;
+  const char *doc = nullptr;
+  uint16_t count = 1;
+  uint64_t stride = 0;
+};
+
+/**
+ * Simulator side of a register: `read` returns the current value, `write`
+ * stores a value and runs any side effects. `idx` is the index within a
+ * register array (0 otherwise). Either may be null for WO/RO registers.
+ */
+template <class Dev>
+struct RegOps {
+  const char *name;  /* must match the RegInfo at the same position */
+  uint64_t (*read)(Dev &dev, unsigned idx);
+  void (*write)(Dev &dev, unsigned idx, uint64_t val);
+};
+
+/** Dev type for models that keep their register state in globals. */
+struct NoDev {};
+
+/**
+ * RegOps accessors for a register backed by `Field`: a pointer to a member of
+ * Dev or to a global, of integer or integer array type (indexed by the
+ * register array index). E.g. `{"SQ_BASE", FieldOps<Dev, &sq_base>::Read,
+ * FieldOps<Dev, &sq_base>::Write}`.
+ */
+template <class Dev, auto Field>
+struct FieldOps {
+  static uint64_t Read(Dev &dev, unsigned idx) { return Ref(dev, idx); }
+
+  static void Write(Dev &dev, unsigned idx, uint64_t val) {
+    auto &ref = Ref(dev, idx);
+    ref = static_cast<std::remove_reference_t<decltype(ref)>>(val);
+  }
+
+ private:
+  static auto &Ref(Dev &dev, unsigned idx) {
+    if constexpr (std::is_member_object_pointer_v<decltype(Field)>)
+      return Elem(dev.*Field, idx);
+    else
+      return Elem(*Field, idx);
+  }
+
+  template <class T>
+  static T &Elem(T &val, unsigned) { return val; }
+
+  template <class T, size_t N>
+  static T &Elem(T (&arr)[N], unsigned idx) { return arr[idx]; }
+};
+
+/**
+ * Compile-time register map, built with MakeRegMap. Dispatch is a single
+ * table lookup: offsets are split into slots of 2^kShift bytes (the largest
+ * power of two all register offsets are aligned to), and each slot records
+ * which register (and array index) starts there. Accesses must hit the start
+ * of a register and be at most its width; narrower accesses read or write the
+ * low bytes.
+ */
+template <class Dev, size_t N, unsigned kShift, size_t kSlots>
+struct RegMap {
+  struct Slot {
+    uint8_t reg;  /* index in regs + 1, 0 if no register starts here */
+    uint8_t idx;
+  };
+
+  RegInfo info[N];
+  RegOps<Dev> ops[N];
+  Slot slots[kSlots];
+
+  /** False if there is no readable register at `offset`. */
+  bool Read(Dev &dev, uint64_t offset, size_t len, uint64_t &val) const {
+    const Slot *s = Lookup(offset);
+    if (!s)
+      return false;
+    const RegInfo &ri = info[s->reg - 1];
+    const RegOps<Dev> &ro = ops[s->reg - 1];
+    if (ri.access == Access::kWO || !ro.read || len > ri.width)
+      return false;
+    val = ro.read(dev, s->idx);
+    if (len < 8)
+      val &= (1ULL << (len * 8)) - 1;
+    return true;
+  }
+
+  /** False if there is no writable register at `offset`. */
+  bool Write(Dev &dev, uint64_t offset, size_t len, uint64_t val) const {
+    const Slot *s = Lookup(offset);
+    if (!s)
+      return false;
+    const RegInfo &ri = info[s->reg - 1];
+    const RegOps<Dev> &ro = ops[s->reg - 1];
+    if (ri.access == Access::kRO || !ro.write || len > ri.width)
+      return false;
+    if (len < 8)
+      val &= (1ULL << (len * 8)) - 1;
+    ro.write(dev, s->idx, val);
+    return true;
+  }
+
+ private:
+  const Slot *Lookup(uint64_t offset) const {
+    uint64_t slot = offset >> kShift;
+    if (slot >= kSlots || (slot << kShift) != offset || !slots[slot].reg)
+      return nullptr;
+    return &slots[slot];
+  }
+};
+
+namespace regmap_internal {
+
+constexpr bool StrEq(const char *a, const char *b) {
+  while (*a && *a == *b) {
+    a++;
+    b++;
+  }
+  return *a == *b;
+}
+
+template <size_t N>
+constexpr bool Valid(const RegInfo (&info)[N]) {
+  for (size_t i = 0; i < N; i++) {
+    const RegInfo &a = info[i];
+    if (a.width < 1 || a.width > 8 || a.count < 1 || a.count > 256 ||
+        (a.count > 1 && a.stride < a.width))
+      return false;
+    for (size_t j = 0; j < N; j++) {
+      const RegInfo &b = info[j];
+      for (unsigned k = 0; k < a.count; k++) {
+        for (unsigned l = 0; l < b.count; l++) {
+          if (i == j && k == l)
+            continue;
+          uint64_t ao = a.offset + k * a.stride, bo = b.offset + l * b.stride;
+          if (ao < bo + b.width && bo < ao + a.width)
+            return false;
+        }
+      }
+    }
+  }
+  return N < 256;
+}
+
+template <class Dev, size_t N>
+constexpr bool NamesMatch(const RegInfo (&info)[N],
+    const RegOps<Dev> (&ops)[N]) {
+  for (size_t i = 0; i < N; i++) {
+    if (!StrEq(info[i].name, ops[i].name))
+      return false;
+  }
+  return true;
+}
+
+template <class Dev, size_t N>
+Dev *DevOf(const RegOps<Dev> (&ops)[N]);
+
+/* print `doc` as a comment wrapped at 80 columns */
+inline void PrintDoc(FILE *f, const char *doc) {
+  const char *prefix = "/** ";
+  size_t col = 0;
+  while (*doc) {
+    size_t len = 0;
+    while (doc[len] && doc[len] != ' ')
+      len++;
+    if (col == 0) {
+      col = fprintf(f, "%s", prefix);
+      prefix = "    ";
+    } else if (col + 1 + len > 77) {
+      fprintf(f, "\n");
+      col = fprintf(f, "%s", prefix);
+    } else {
+      col += fprintf(f, " ");
+    }
+    col += fprintf(f, "%.*s", (int) len, doc);
+    doc += len;
+    while (*doc == ' ')
+      doc++;
+  }
+  fprintf(f, " */\n");
+}
+
+template <size_t N>
+constexpr unsigned Shift(const RegInfo (&info)[N]) {
+  uint64_t bits = 0;
+  for (size_t i = 0; i < N; i++)
+    bits |= info[i].offset | (info[i].count > 1 ? info[i].stride : 0);
+  unsigned shift = 0;
+  while (shift < 12 && !(bits & (1ULL << shift)))
+    shift++;
+  return shift;
+}
+
+template <size_t N>
+constexpr size_t Slots(const RegInfo (&info)[N]) {
+  uint64_t end = 0;
+  for (size_t i = 0; i < N; i++) {
+    uint64_t last = info[i].offset + (info[i].count - 1) * info[i].stride;
+    if (last + 1 > end)
+      end = last + 1;
+  }
+  unsigned shift = Shift(info);
+  return (end + (1ULL << shift) - 1) >> shift;
+}
+
+}  // namespace regmap_internal
+
+/**
+ * Build the RegMap for register layout `Info` (a constexpr RegInfo array) and
+ * accessors `Ops` (a constexpr RegOps array in the same order), e.g.
+ * `static constexpr auto kRegs = MakeRegMap<kRegInfo, kRegOps>();`.
+ * Overlapping registers or mismatched names fail to compile.
+ */
+template <const auto &Info, const auto &Ops>
+constexpr auto MakeRegMap() {
+  using Dev = std::remove_pointer_t<decltype(regmap_internal::DevOf(Ops))>;
+  constexpr size_t N = std::extent_v<std::remove_reference_t<decltype(Info)>>;
+  static_assert(std::extent_v<std::remove_reference_t<decltype(Ops)>> == N,
+                "need one RegOps per RegInfo");
+  static_assert(regmap_internal::Valid(Info),
+                "invalid or overlapping registers");
+  static_assert(regmap_internal::NamesMatch(Info, Ops),
+                "RegOps names do not match the RegInfo order");
+  constexpr unsigned kShift = regmap_internal::Shift(Info);
+  constexpr size_t kSlots = regmap_internal::Slots(Info);
+
+  RegMap<Dev, N, kShift, kSlots> map = {};
+  for (size_t i = 0; i < N; i++) {
+    map.info[i] = Info[i];
+    map.ops[i] = Ops[i];
+    for (unsigned k = 0; k < Info[i].count; k++) {
+      uint64_t slot = (Info[i].offset + k * Info[i].stride) >> kShift;
+      map.slots[slot].reg = i + 1;
+      map.slots[slot].idx = k;
+    }
+  }
+  return map;
+}
+
+/**
+ * Print register layout `info` as a C header for the driver: REG_<NAME> is
+ * the register offset, register arrays also get REG_<NAME>_NUM and
+ * REG_<NAME>_STRIDE.
+ */
+template <size_t N>
+void PrintCHeader(FILE *f, const RegInfo (&info)[N], const char *guard) {
+  static const char *const access[] = {"RO", "WO", "RW"};
+
+  fprintf(f, "/* Generated from the register layout, do not edit. */\n\n");
+  fprintf(f, "#ifndef %s\n#define %s\n", guard, guard);
+  for (size_t i = 0; i < N; i++) {
+    const RegInfo &r = info[i];
+    fprintf(f, "\n");
+    if (r.doc)
+      regmap_internal::PrintDoc(f, r.doc);
+    fprintf(f, "#define REG_%s 0x%02lx // %s, %uB\n", r.name,
+            (unsigned long) r.offset, access[(int) r.access], r.width);
+    if (r.count > 1) {
+      fprintf(f, "#define REG_%s_NUM %u\n", r.name, r.count);
+      fprintf(f, "#define REG_%s_STRIDE 0x%lx\n", r.name,
+              (unsigned long) r.stride);
+    }
+  }
+  fprintf(f, "\n#endif  // ndef %s\n", guard);
+}
+
+}  // namespace accelsim
+
+#endif  // ndef ACCEL_SIM_REGMAP_H_
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ACCEL_SIM_SCHED_H_
+#define ACCEL_SIM_SCHED_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace accelsim {
+
+/**
+ * Timed event queue. Events are plain (time, id, arg) triples the owner
+ * dispatches on; they are kept in a binary heap, so scheduling and popping
+ * are O(log n) and do not allocate once the heap has grown to its working
+ * size. Events due at the same time are returned in the order they were
+ * scheduled.
+ */
+class EventScheduler {
+ public:
+  struct Event {
+    uint64_t time;
+    uint64_t seq;
+    uint32_t id;
+    uint64_t arg;
+  };
+
+  void Schedule(uint64_t time, uint32_t id, uint64_t arg = 0) {
+    heap_.push_back({time, seq_++, id, arg});
+    std::push_heap(heap_.begin(), heap_.end(), Later);
+  }
+
+  /** Time of the earliest pending event or UINT64_MAX. */
+  uint64_t Next() const {
+    return heap_.empty() ? UINT64_MAX : heap_.front().time;
+  }
+
+  /** Remove the earliest event into `ev` if it is due at `now`. */
+  bool PopDue(uint64_t now, Event &ev) {
+    if (heap_.empty() || heap_.front().time > now)
+      return false;
+    std::pop_heap(heap_.begin(), heap_.end(), Later);
+    ev = heap_.back();
+    heap_.pop_back();
+    return true;
+  }
+
+  size_t Size() const { return heap_.size(); }
+
+ private:
+  static bool Later(const Event &a, const Event &b) {
+    return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+  }
+
+  std::vector<Event> heap_;
+  uint64_t seq_ = 0;
+};
+
+}  // namespace accelsim
+
+#endif  // ndef ACCEL_SIM_SCHED_H_
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ACCEL_SIM_STATS_H_
+#define ACCEL_SIM_STATS_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+
+namespace accelsim {
+
+/**
+ * Named event counters. Printed as `NAME = value` lines at exit, which is the
+ * format the test checks parse (e.g. `DMA READS = 42`).
+ */
+class Stats {
+ public:
+  /** Register a new counter. The returned reference stays valid. */
+  uint64_t &Counter(const char *name) {
+    counters_.push_back({name, 0});
+    return counters_.back().value;
+  }
+
+  void Print(FILE *f) const {
+    for (const Entry &c : counters_)
+      fprintf(f, "%s = %lu\n", c.name, c.value);
+  }
+
+ private:
+  struct Entry {
+    const char *name;
+    uint64_t value;
+  };
+  std::deque<Entry> counters_;
+};
+
+}  // namespace accelsim
+
+#endif  // ndef ACCEL_SIM_STATS_H_
@@ -3,6 +3,12 @@ CFLAGS= -Wall -Wextra -Wno-unused-parameter -O3 $(EXTRA_CFLAGS)
 CXXFLAGS= -Wall -Wextra -O3 $(EXTRA_CXXFLAGS)
 LDFLAGS= -L/simbricks/lib $(EXTRA_LDFLAGS)
 
+# SIMD kernels of the optimized CPU baseline (matmul-cpu.c): SSE2 by default
+# (gem5's x86 CPUs have no AVX), make SIMD=avx2 for AVX2 on real hardware
+ifeq ($(SIMD),avx2)
+../common/matmul-cpu.o: CFLAGS+=-mavx2
+endif
+
 SIMBRICKS_FLAGS:=
 
 ifeq ($(PARALLEL),y)
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* CPU reference multiplication: the usual three levels of blocking (NC
+   output columns, KC steps of k, MR x NR micro-tiles) with both inputs packed
+   so the micro-kernel reads them sequentially.
+
+   There is no byte multiply in SSE2/AVX2, and the byte dot-products
+   (pmaddubsw) treat one operand as signed and saturate their 16-bit sums,
+   which breaks mod 256 arithmetic. The kernel multiplies in 16-bit lanes
+   instead: the low byte of a 16-bit product only depends on the low bytes
+   of the factors, and sums only carry upwards, so multiplying B's byte pairs
+   by a zero-extended A value gives the even column's products in the low
+   byte, and with the even byte masked off, the odd column's in the high
+   byte. Two accumulators per vector keep both, merged once per micro-tile. */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "matmul-cpu.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+typedef __m256i vec_t;
+#define VEC_BYTES 32
+#define VLOAD(p) _mm256_loadu_si256((const __m256i *) (p))
+#define VSTORE(p, v) _mm256_storeu_si256((__m256i *) (p), v)
+#define VSET16(x) _mm256_set1_epi16(x)
+#define VMUL16(a, b) _mm256_mullo_epi16(a, b)
+#define VADD16(a, b) _mm256_add_epi16(a, b)
+#define VADD8(a, b) _mm256_add_epi8(a, b)
+#define VAND(a, b) _mm256_and_si256(a, b)
+#define VOR(a, b) _mm256_or_si256(a, b)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+typedef __m128i vec_t;
+#define VEC_BYTES 16
+#define VLOAD(p) _mm_loadu_si128((const __m128i *) (p))
+#define VSTORE(p, v) _mm_storeu_si128((__m128i *) (p), v)
+#define VSET16(x) _mm_set1_epi16(x)
+#define VMUL16(a, b) _mm_mullo_epi16(a, b)
+#define VADD16(a, b) _mm_add_epi16(a, b)
+#define VADD8(a, b) _mm_add_epi8(a, b)
+#define VAND(a, b) _mm_and_si128(a, b)
+#define VOR(a, b) _mm_or_si128(a, b)
+#endif
+
+/* micro-tile rows, and columns: one vector */
+#define MR 4
+#ifdef VEC_BYTES
+#define NR VEC_BYTES
+/* packed A holds each element already broadcast into a vector */
+typedef vec_t apack_t;
+#define APACK(x) VSET16(x)
+#else
+#define NR 16
+typedef uint8_t apack_t;
+#define APACK(x) (x)
+#endif
+/* k steps and output columns per packed block */
+#define KC 128
+#define NC 256
+
+/** Pack rows i..i+MR-1, columns k..k+kc-1 of A, k-major, zero rows past n */
+static void pack_a(apack_t *dst, const uint8_t *A, size_t n, size_t i,
+                   size_t k, size_t kc) {
+  size_t r, p;
+  for (p = 0; p < kc; p++) {
+    for (r = 0; r < MR; r++)
+      dst[p * MR + r] = APACK(i + r < n ? A[(i + r) * n + k + p] : 0);
+  }
+}
+
+/** Pack rows k..k+kc-1, columns j..j+nc-1 of B as panels of NR columns,
+ * each kc x NR and row-major, zero columns past n */
+static void pack_b(uint8_t *dst, const uint8_t *B, size_t n, size_t k,
+                   size_t kc, size_t j, size_t nc) {
+  size_t c, p, jr;
+  for (jr = 0; jr < nc; jr += NR) {
+    size_t cols = nc - jr < NR ? nc - jr : NR;
+    for (p = 0; p < kc; p++) {
+      const uint8_t *src = B + (k + p) * n + j + jr;
+      memcpy(dst, src, cols);
+      for (c = cols; c < NR; c++)
+        dst[c] = 0;
+      dst += NR;
+    }
+  }
+}
+
+/** Add the product of packed panels `a` and `b` onto the `rows` x `cols`
+ * output tile at `c` */
+static void kernel(const apack_t *a, const uint8_t *b, size_t kc, uint8_t *c,
+                   size_t ldc, size_t rows, size_t cols) {
+  uint8_t tile[MR][NR];
+  size_t r, p;
+
+#ifdef VEC_BYTES
+  const vec_t lo = VSET16(0x00ff);
+  const vec_t hi = VSET16((short) 0xff00);
+  vec_t even[MR], odd[MR];
+
+  for (r = 0; r < MR; r++)
+    even[r] = odd[r] = VSET16(0);
+  for (p = 0; p < kc; p++) {
+    vec_t bv = VLOAD(b + p * NR);
+    vec_t bh = VAND(bv, hi);
+    for (r = 0; r < MR; r++) {
+      even[r] = VADD16(even[r], VMUL16(bv, a[p * MR + r]));
+      odd[r] = VADD16(odd[r], VMUL16(bh, a[p * MR + r]));
+    }
+  }
+  // the low bytes of `odd` are always 0
+  for (r = 0; r < MR; r++)
+    even[r] = VOR(VAND(even[r], lo), odd[r]);
+
+  if (rows == MR && cols == NR) {
+    for (r = 0; r < MR; r++)
+      VSTORE(c + r * ldc, VADD8(VLOAD(c + r * ldc), even[r]));
+    return;
+  }
+  for (r = 0; r < MR; r++)
+    VSTORE(tile[r], even[r]);
+#else
+  size_t j;
+  memset(tile, 0, sizeof(tile));
+  for (p = 0; p < kc; p++) {
+    for (r = 0; r < MR; r++) {
+      for (j = 0; j < NR; j++)
+        tile[r][j] += a[p * MR + r] * b[p * NR + j];
+    }
+  }
+#endif
+
+  for (r = 0; r < rows; r++) {
+    size_t j2;
+    for (j2 = 0; j2 < cols; j2++)
+      c[r * ldc + j2] += tile[r][j2];
+  }
+}
+
+/** Output rows [i0, i1) of one multiplication, for one thread */
+struct cpu_job {
+  const uint8_t *A, *B;
+  uint8_t *out;
+  size_t n;
+  size_t i0, i1;
+  pthread_t thread;
+  bool started;
+};
+
+static void *cpu_rows(void *arg) {
+  const struct cpu_job *job = arg;
+  static __thread apack_t apack[KC * MR];
+  static __thread uint8_t bpack[KC * NC] __attribute__((aligned(64)));
+  size_t n = job->n;
+  size_t i, j, k, jr;
+
+  memset(job->out + job->i0 * n, 0, (job->i1 - job->i0) * n);
+  for (j = 0; j < n; j += NC) {
+    size_t nc = n - j < NC ? n - j : NC;
+    for (k = 0; k < n; k += KC) {
+      size_t kc = n - k < KC ? n - k : KC;
+      pack_b(bpack, job->B, n, k, kc, j, nc);
+      for (i = job->i0; i < job->i1; i += MR) {
+        size_t rows = job->i1 - i < MR ? job->i1 - i : MR;
+        pack_a(apack, job->A, n, i, k, kc);
+        for (jr = 0; jr < nc; jr += NR) {
+          size_t cols = nc - jr < NR ? nc - jr : NR;
+          kernel(apack, bpack + jr * kc, kc, job->out + i * n + j + jr, n,
+                 rows, cols);
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+void matmult_cpu(const uint8_t *A, const uint8_t *B, uint8_t *out, size_t n,
+                 size_t threads) {
+  size_t t, tiles = (n + MR - 1) / MR;
+
+  if (!threads) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = cpus > 0 ? cpus : 1;
+  }
+  if (threads > tiles)
+    threads = tiles ? tiles : 1;
+
+  /* whole micro-tile rows per thread, the caller is thread 0 */
+  struct cpu_job jobs[threads];
+  for (t = 0; t < threads; t++) {
+    jobs[t].A = A;
+    jobs[t].B = B;
+    jobs[t].out = out;
+    jobs[t].n = n;
+    jobs[t].i0 = tiles * t / threads * MR;
+    jobs[t].i1 = tiles * (t + 1) / threads * MR;
+    if (jobs[t].i1 > n)
+      jobs[t].i1 = n;
+  }
+  // without a thread, the caller does the rows itself
+  for (t = 1; t < threads; t++) {
+    jobs[t].started = !pthread_create(&jobs[t].thread, NULL, cpu_rows,
+                                      &jobs[t]);
+    if (!jobs[t].started)
+      cpu_rows(&jobs[t]);
+  }
+  cpu_rows(&jobs[0]);
+  for (t = 1; t < threads; t++) {
+    if (jobs[t].started)
+      pthread_join(jobs[t].thread, NULL);
+  }
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef MATMUL_CPU_H_
+#define MATMUL_CPU_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * CPU reference multiplication of the n x n byte matrices `A` and `B` into
+ * `out`, with the same wrap-around (mod 256) arithmetic as the accelerators.
+ * Cache-blocked, with both inputs packed into panels for a SIMD
+ * micro-kernel (AVX2 when built with -mavx2, else SSE2, else scalar), and
+ * the output rows split over `threads` threads (0 for one per online CPU).
+ */
+void matmult_cpu(const uint8_t *A, const uint8_t *B, uint8_t *out, size_t n,
+                 size_t threads);
+
+#endif  // ndef MATMUL_CPU_H_
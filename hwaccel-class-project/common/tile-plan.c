@@ -0,0 +1,138 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tile-plan.h"
+
+void devmem_init(struct devmem *m, uint64_t size) {
+  m->size = size;
+  m->used = 0;
+}
+
+void devmem_reset(struct devmem *m) {
+  m->used = 0;
+}
+
+int devmem_alloc(struct devmem *m, uint64_t len, uint64_t *off) {
+  if (len > m->size - m->used)
+    return -1;
+  *off = m->used;
+  m->used += len;
+  return 0;
+}
+
+/* can the next A and B loads overlap the current multiplication? */
+static bool pipelined(const struct tile_plan *p) {
+  return p->b_slots > 1 && (p->a_resident || p->a_slots > 1);
+}
+
+/* number of slots that double buffer */
+static unsigned double_buffered(const struct tile_plan *p) {
+  return (p->b_slots > 1) + (p->out_slots > p->rows) +
+         (!p->a_resident && p->a_slots > 1);
+}
+
+/* Estimated device time of plan `p`: the n_b^3 multiplications and the
+   loads run one after the other, or overlap if the plan is pipelined, and
+   the output writes follow them unless the output slots double buffer. */
+static uint64_t est_time(const struct tile_plan *p,
+                         const struct tile_cost *cost) {
+  uint64_t n2 = (uint64_t) p->n_b * p->n_b;
+  uint64_t compute = n2 * p->n_b * cost->compute;
+  uint64_t loads = (p->transfers - n2) * cost->transfer;
+  uint64_t writes = n2 * cost->transfer;
+  uint64_t t;
+
+  if (pipelined(p))
+    t = compute > loads ? compute : loads;
+  else
+    t = compute + loads;
+  if (p->out_slots > p->rows)
+    return t > loads + writes ? t : loads + writes;
+  return t + writes;
+}
+
+/* is `c` a better plan than `p`? */
+static bool better(const struct tile_plan *c, const struct tile_plan *p) {
+  if (c->time != p->time)
+    return c->time < p->time;
+  if (c->transfers != p->transfers)
+    return c->transfers < p->transfers;
+  return double_buffered(c) > double_buffered(p);
+}
+
+static bool fits(const struct tile_plan *p, const struct tile_mem *mem) {
+  if (p->a_slots > mem->a || p->b_slots > mem->b || p->out_slots > mem->out)
+    return false;
+  if (p->a_slots + p->b_slots + p->out_slots > mem->total)
+    return false;
+  // a B tile is only reused across a group if it stays in the one bank all
+  // multiplications of the group read from
+  if (mem->paired && (p->a_slots != p->b_slots || (p->rows > 1 &&
+                                                    p->b_slots > 1)))
+    return false;
+  return true;
+}
+
+int tile_plan(struct tile_plan *p, size_t n_b, const struct tile_mem *mem,
+              const struct tile_cost *cost, size_t max_rows) {
+  struct tile_plan c;
+  uint64_t n2 = (uint64_t) n_b * n_b;
+  bool found = false;
+  size_t rows;
+  int a_res, a_s, b_s, out_d;
+
+  if (!max_rows || max_rows > n_b)
+    max_rows = n_b;
+
+  c.n_b = n_b;
+  for (a_res = 1; a_res >= 0; a_res--) {
+    for (rows = 1; rows <= max_rows; rows++) {
+      for (a_s = 2; a_s >= 1; a_s--) {
+        // the number of streamed A slots only matters without residency
+        if (a_res && a_s == 1)
+          continue;
+        for (b_s = 2; b_s >= 1; b_s--) {
+          for (out_d = 2; out_d >= 1; out_d--) {
+            c.rows = rows;
+            c.a_resident = a_res;
+            c.a_slots = a_res ? rows * n_b : (size_t) a_s;
+            c.b_slots = b_s;
+            c.out_slots = out_d * rows;
+            if (!fits(&c, mem))
+              continue;
+
+            c.transfers = (a_res ? n2 : n2 * n_b) +
+                          n2 * ((n_b + rows - 1) / rows) + n2;
+            c.time = est_time(&c, cost);
+            if (!found || better(&c, p)) {
+              *p = c;
+              found = true;
+            }
+          }
+        }
+      }
+    }
+  }
+  return found ? 0 : -1;
+}
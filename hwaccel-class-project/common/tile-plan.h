@@ -0,0 +1,101 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef TILE_PLAN_H_
+#define TILE_PLAN_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Bump allocator for accelerator memory, reset before each plan. */
+struct devmem {
+  uint64_t size;
+  uint64_t used;
+};
+
+void devmem_init(struct devmem *m, uint64_t size);
+
+void devmem_reset(struct devmem *m);
+
+/** Allocate `len` bytes, stores the offset in `off`. Returns 0 on success and
+ * -1 if there is not enough memory left. */
+int devmem_alloc(struct devmem *m, uint64_t len, uint64_t *off);
+
+/** Accelerator memory available to the planner, in tiles. */
+struct tile_mem {
+  /** Tiles in memory shared by all matrices, SIZE_MAX if unlimited. */
+  size_t total;
+  /** Max. tiles for A, B, and output each, SIZE_MAX if unlimited. */
+  size_t a, b, out;
+  /** A and B tiles live in banks that a multiplication reads together (input
+   * bank i holds one A and one B tile), so a B tile can only be reused by
+   * multiplications in the same bank. */
+  bool paired;
+};
+
+/**
+ * Block schedule for an n_b x n_b block multiplication. Output block rows are
+ * processed in groups of `rows`: for each group, for each block column j, for
+ * each k, B(k, j) is loaded once and multiplied with A(i, k) for every row i
+ * of the group, accumulating into `rows` output blocks. A larger group means
+ * fewer B loads but more output slots. With `a_resident`, the A blocks of the
+ * group stay in accelerator memory for the whole group, otherwise they are
+ * loaded for every multiplication.
+ */
+struct tile_plan {
+  size_t n_b;
+  size_t rows;
+  bool a_resident;
+  /** Slots per matrix. More than one B (or streamed A) slot, or twice `rows`
+   * output slots, means consecutive loads alternate between slots so the
+   * next load can overlap the current multiplication. */
+  size_t a_slots, b_slots, out_slots;
+  /** Tile transfers for one multiplication (A and B loads, output writes) */
+  uint64_t transfers;
+  /** Estimated device time of one multiplication, see tile_plan */
+  uint64_t time;
+};
+
+/** Estimated device time of one tile multiplication and of one tile
+ * transfer, in any unit as long as it is the same for both (e.g. cycles). */
+struct tile_cost {
+  uint64_t compute;
+  uint64_t transfer;
+};
+
+/**
+ * Pick a schedule that fits `mem`, with groups of at most `max_rows` rows (0
+ * for no limit). The schedule with the shortest estimated time for `cost`
+ * wins: multiplications and loads add up, unless the schedule lets the next
+ * loads overlap the current multiplication, and output writes add on top
+ * unless they are double buffered. Ties go to the fewest tile transfers, then
+ * the most double buffering, so where overlap can not hide the extra traffic
+ * of a schedule the one with the fewest transfers wins. Returns 0 on success
+ * and -1 if not even one tile per matrix fits.
+ */
+int tile_plan(struct tile_plan *p, size_t n_b, const struct tile_mem *mem,
+              const struct tile_cost *cost, size_t max_rows);
+
+#endif /* ndef TILE_PLAN_H_ */
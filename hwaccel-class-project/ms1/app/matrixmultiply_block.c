@@ -58,7 +58,26 @@ void matmult_block(const uint8_t *inA, const uint8_t *inB, uint8_t *out,
     size_t n, size_t block) {
   memset(out, 0, n * n);
 
-  /* IMPLEMENT THIS */
+  size_t i0, j0, k0, i, j, k;
+
+  /* multiply block by block, so the blocks of A, B, and out in use stay in
+     the cache */
+  for (i0 = 0; i0 < n; i0 += block) {
+    size_t i1 = i0 + block < n ? i0 + block : n;
+    for (k0 = 0; k0 < n; k0 += block) {
+      size_t k1 = k0 + block < n ? k0 + block : n;
+      for (j0 = 0; j0 < n; j0 += block) {
+        size_t j1 = j0 + block < n ? j0 + block : n;
+        for (i = i0; i < i1; i++) {
+          for (k = k0; k < k1; k++) {
+            uint8_t a = inA[i * n + k];
+            for (j = j0; j < j1; j++)
+              out[i * n + j] += a * inB[k * n + j];
+          }
+        }
+      }
+    }
+  }
 }
 
 void test(size_t n, size_t block_size)
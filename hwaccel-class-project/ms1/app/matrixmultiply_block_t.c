@@ -58,7 +58,37 @@ void matmult_block(const uint8_t *inA, const uint8_t *inB, uint8_t *out,
     size_t n, size_t block) {
   memset(out, 0, n * n);
 
-  /* IMPLEMENT HERE */
+  size_t i0, j0, k0, i, j, k;
+  uint8_t *Bt = malloc(n * n);
+  if (!Bt) {
+    fprintf(stderr, "matmult_block: allocating transposed B failed\n");
+    exit(1);
+  }
+
+  /* transpose B, so the inner loop walks rows of both inputs */
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < n; j++)
+      Bt[j * n + i] = inB[i * n + j];
+  }
+
+  for (i0 = 0; i0 < n; i0 += block) {
+    size_t i1 = i0 + block < n ? i0 + block : n;
+    for (j0 = 0; j0 < n; j0 += block) {
+      size_t j1 = j0 + block < n ? j0 + block : n;
+      for (k0 = 0; k0 < n; k0 += block) {
+        size_t k1 = k0 + block < n ? k0 + block : n;
+        for (i = i0; i < i1; i++) {
+          for (j = j0; j < j1; j++) {
+            uint8_t sum = out[i * n + j];
+            for (k = k0; k < k1; k++)
+              sum += inA[i * n + k] * Bt[j * n + k];
+            out[i * n + j] = sum;
+          }
+        }
+      }
+    }
+  }
+  free(Bt);
 }
 
 void test(size_t n, size_t block_size)
@@ -0,0 +1,133 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Optimized CPU baseline (see common/matmul-cpu.c): cache-blocked, packed,
+   SIMD, and multi-threaded, as the realistic software comparison point for
+   the accelerators. Checks the result against the simple multiplication, or
+   measures both. */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <matmul-cpu.h>
+#include <utils.h>
+
+uint8_t *zero_matrix_alloc(size_t m, size_t n) {
+  return calloc(m * n, sizeof(uint8_t));
+}
+
+uint8_t *rand_matrix_alloc(size_t m, size_t n) {
+  uint8_t *A = zero_matrix_alloc(m, n);
+  size_t i;
+  for (i = 0; i < m * n; i++)
+    A[i] = rand();
+  return A;
+}
+
+void matmult(const uint8_t *inA, const uint8_t *inB, uint8_t *out, size_t n) {
+  size_t i, j, k;
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < n; j++) {
+      out[i * n + j] = 0;
+      for (k = 0; k < n; k++) {
+        out[i * n + j] += inA[i * n + k] * inB[k * n + j];
+      }
+    }
+  }
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void test(size_t n, size_t threads)
+{
+  uint8_t *A = rand_matrix_alloc(n, n);
+  uint8_t *B = rand_matrix_alloc(n, n);
+  uint8_t *out_orig = zero_matrix_alloc(n, n);
+  uint8_t *out_f = zero_matrix_alloc(n, n);
+
+  matmult(A, B, out_orig, n);
+  matmult_cpu(A, B, out_f, n, threads);
+
+  if (!memcmp(out_orig, out_f, n * n))
+    printf("STATUS: Success matrices match\n");
+  else
+    printf("STATUS: Failure Matrices do not match\n");
+}
+
+/* one run of the simple multiplication, `iterations` of the optimized one.
+   GOPS counts a multiply and an add per inner step. */
+void measure(size_t n, size_t iterations, size_t threads)
+{
+  uint8_t *A = rand_matrix_alloc(n, n);
+  uint8_t *B = rand_matrix_alloc(n, n);
+  uint8_t *out = zero_matrix_alloc(n, n);
+  double ops = 2.0 * n * n * n;
+
+  uint64_t start = rdtsc(), start_ns = now_ns();
+  matmult(A, B, out, n);
+  uint64_t naive_cycles = rdtsc() - start;
+  uint64_t naive_ns = now_ns() - start_ns;
+
+  size_t i;
+  uint64_t total_cycles = 0, total_ns = 0;
+  for (i = 0; i < iterations; i++) {
+    start = rdtsc();
+    start_ns = now_ns();
+    matmult_cpu(A, B, out, n, threads);
+    total_cycles += rdtsc() - start;
+    total_ns += now_ns() - start_ns;
+  }
+
+  printf("Cycles per operation: %ld\n", total_cycles / iterations);
+  printf("Naive cycles per operation: %ld\n", naive_cycles);
+  printf("GOPS: naive %.3f optimized %.3f speedup %.1f\n",
+         ops / naive_ns, ops * iterations / total_ns,
+         (double) naive_ns * iterations / total_ns);
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 2 || argc > 4) {
+    fprintf(stderr, "Usage: mm_fast MATRIX-SIZE [ITERATIONS [THREADS]]\n");
+    return 1;
+  }
+
+  /* 0 threads: one per online CPU */
+  size_t size = strtoull(argv[1], NULL, 10);
+  size_t threads = argc > 3 ? strtoull(argv[3], NULL, 10) : 0;
+  if (argc == 2) {
+    test(size, threads);
+  } else {
+    size_t its = strtoull(argv[2], NULL, 10);
+    measure(size, its, threads);
+  }
+  return 0;
+}
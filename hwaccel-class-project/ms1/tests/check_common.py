@@ -15,10 +15,14 @@ def exception_thrown():
     sys.exit(e.code)
   traceback.print_exc()
 
-def fail(msg):
+test_fn = None
+
+def fail(msg, inspect=None):
   global tname
   global test_fn
-  print(f'FAILED {tname}:', msg, f' (inspect {test_fn})', file=sys.stderr)
+  inspect = inspect or test_fn
+  hint = f' (inspect {inspect})' if inspect else ''
+  print(f'FAILED {tname}:', msg, hint, file=sys.stderr)
   sys.exit(1)
 
 def success():
@@ -48,7 +52,7 @@ def load_testfile(fn):
 
     if not data['success']:
       fail(f'Simulation was not successful')
-  except e:
+  except Exception:
     traceback.print_exc()
     fail('Loading simulation JSON output failed')
 
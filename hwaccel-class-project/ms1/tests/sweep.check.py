@@ -0,0 +1,149 @@
+# Collects the block-size sweep (sweep.sim.py): cycles from the application
+# output in the JSON, L1 data and L2 cache misses from gem5's stats.txt of
+# each configuration. Prints a table and, per variant, a size x block heatmap
+# of cycles and misses relative to the best block size for that matrix size,
+# and writes all of it to out/sweep.csv (and out/sweep.png if matplotlib is
+# available).
+
+import csv
+import re
+
+from check_common import *
+from sweep_common import *
+
+# gem5 has renamed the miss counters over time, take whichever is there
+MISS_STATS = ['overall_misses::total', 'overallMisses::total',
+              'demand_misses::total', 'demandMisses::total']
+CACHES = {
+  'l1d': re.compile(r'^system\.(.+\.)?dcache\.'),
+  'l2': re.compile(r'^system\.(.+\.)?l2(cache)?\.'),
+}
+
+
+def load_stats(fn):
+  """Statistics of the last dump in a gem5 stats.txt (the one after the
+  multiplication)."""
+  stats = {}
+  with open(fn, 'r') as f:
+    for l in f:
+      if l.startswith('---------- Begin Simulation Statistics'):
+        stats = {}
+        continue
+      parts = l.split()
+      if len(parts) >= 2:
+        stats[parts[0]] = parts[1]
+  return stats
+
+
+def misses(stats, cache):
+  for suffix in MISS_STATS:
+    for name, val in stats.items():
+      if name.endswith('.' + suffix) and CACHES[cache].match(name):
+        return int(float(val))
+  return None
+
+
+def heatmap(title, rows, key):
+  """Text heatmap of `key` for each size (row) and block (column), relative
+  to the smallest value in the row, which is marked with *."""
+  print(f'\n{title}')
+  print('     n ' + ''.join(f'{b:>9}' for b in BLOCKS))
+  for n in SIZES:
+    vals = {r['block']: r[key] for r in rows if r['n'] == n and
+            r[key] is not None}
+    line = f'{n:>6} '
+    best = min(vals.values()) if vals else None
+    for b in BLOCKS:
+      if b not in vals:
+        line += f'{"-":>9}'
+      elif best == 0:
+        line += f'{vals[b]:>9}'
+      else:
+        mark = '*' if vals[b] == best else ' '
+        line += f'{vals[b] / best:>8.2f}{mark}'
+    print(line)
+
+
+def plot(results, fn):
+  try:
+    import matplotlib
+    matplotlib.use('Agg')
+    import matplotlib.pyplot as plt
+  except ImportError:
+    return
+
+  keys = ['cycles', 'l1d', 'l2']
+  fig, axes = plt.subplots(len(VARIANTS), len(keys), squeeze=False,
+                           figsize=(4 * len(keys), 3 * len(VARIANTS)))
+  for vi, v in enumerate(VARIANTS):
+    for ki, key in enumerate(keys):
+      grid = [[float('nan')] * len(BLOCKS) for _ in SIZES]
+      for r in results:
+        if r['variant'] == v and r[key] is not None:
+          grid[SIZES.index(r['n'])][BLOCKS.index(r['block'])] = r[key]
+      # relative to the best block size per matrix size
+      for row in grid:
+        best = min([x for x in row if x == x] or [1]) or 1
+        row[:] = [x / best for x in row]
+      ax = axes[vi][ki]
+      im = ax.imshow(grid, cmap='viridis_r', aspect='auto')
+      ax.set_title(f'{v}: {key} (x best)')
+      ax.set_xticks(range(len(BLOCKS)), [str(b) for b in BLOCKS])
+      ax.set_yticks(range(len(SIZES)), [str(n) for n in SIZES])
+      ax.set_xlabel('block')
+      ax.set_ylabel('n')
+      fig.colorbar(im, ax=ax)
+  fig.tight_layout()
+  fig.savefig(fn)
+
+
+test_name('sweep')
+
+results = []
+missing = []
+for (v, n, b) in configs():
+  name = exp_name(v, n, b)
+  r = {'variant': v, 'n': n, 'block': b, 'cycles': None, 'l1d': None,
+       'l2': None}
+  results.append(r)
+  # a partial sweep still gets its table, only the missing runs are listed
+  if not os.path.isfile(f'out/{name}-1.json'):
+    missing.append(f'{name} (no JSON output)')
+    continue
+
+  data = load_testfile(f'out/{name}-1.json')
+  try:
+    line = find_line(data['sims']['host.host']['stdout'],
+                     '^Cycles per operation: ([0-9]*)')
+    if not line:
+      raise ValueError('no cycles in output')
+    r['cycles'] = int(line.group(1))
+
+    stats = load_stats(f'out/{name}/1/gem5-out.host/stats.txt')
+    for cache in CACHES:
+      r[cache] = misses(stats, cache)
+  except Exception as e:
+    missing.append(f'{name} ({e})')
+
+print(f'{"variant":>8} {"n":>5} {"block":>5} {"cycles":>12} '
+      f'{"L1D misses":>11} {"L2 misses":>10}')
+for r in results:
+  print(f'{r["variant"]:>8} {r["n"]:>5} {r["block"]:>5} '
+        f'{str(r["cycles"]):>12} {str(r["l1d"]):>11} {str(r["l2"]):>10}')
+
+for v in VARIANTS:
+  rows = [r for r in results if r['variant'] == v]
+  heatmap(f'{v}: cycles (x best block size)', rows, 'cycles')
+  heatmap(f'{v}: L1D misses (x best block size)', rows, 'l1d')
+  heatmap(f'{v}: L2 misses (x best block size)', rows, 'l2')
+
+os.makedirs('out', exist_ok=True)
+with open('out/sweep.csv', 'w', newline='') as f:
+  w = csv.DictWriter(f, fieldnames=list(results[0].keys()) if results else [])
+  w.writeheader()
+  w.writerows(results)
+plot(results, 'out/sweep.png')
+
+if missing:
+  fail('missing results: ' + ', '.join(missing), inspect='out/sweep-*')
+success()
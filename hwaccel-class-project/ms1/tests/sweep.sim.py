@@ -0,0 +1,52 @@
+# SWEEP: cache behaviour of the block multiplications over matrix sizes, block
+# sizes, and with/without transposition (see sweep_common.py for the grid).
+# Each configuration is its own timing simulation. The statistics are reset
+# before the application starts and dumped after it exits, so gem5's stats.txt
+# covers the whole run: startup, filling the matrices, and the multiplication.
+# The setup is the same for all block sizes of a matrix size, so the misses
+# still compare block sizes. The cycles are measured around matmult_block
+# only. sweep.check.py collects the results.
+
+import sys; sys.path.append('./tests/')
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+import simbricks.orchestration.nodeconfig as node
+import simbricks.orchestration.experiment.experiment_environment as env
+
+from sweep_common import *
+
+class MatMulApp(node.AppConfig):
+    def __init__(self, binary, n, block):
+       super().__init__()
+       self.binary = binary
+       self.n = n
+       self.block = block
+    def run_cmds(self, node):
+        # application command to run once the host is booted up
+        return ['m5 resetstats',
+                f'/tmp/guest/{self.binary} {self.n} {self.block} 1',
+                'm5 dumpstats']
+
+    def config_files(self, environment: env.ExpEnv):
+        # copy matrixmultiply binary into host image during prep
+        m = {self.binary: open(f'app/{self.binary}', 'rb')}
+        return {**m, **super().config_files(environment)}
+
+experiments = []
+
+for (v, n, b) in configs():
+  e = exp.Experiment(exp_name(v, n, b))
+  e.checkpoint = True
+
+  server_config = node.NodeConfig()
+  server_config.app = MatMulApp(VARIANTS[v], n, b)
+
+  server = sim.Gem5Host(server_config)
+  server.name = 'host'
+  server.cpu_type = 'TimingSimpleCPU'
+  server.cpu_freq = '1GHz'
+
+  e.add_host(server)
+  server.wait = True
+
+  experiments.append(e)
@@ -0,0 +1,27 @@
+import os
+
+# Grid of the block-size sweep (sweep.sim.py/sweep.check.py). Override with
+# e.g. `SWEEP_SIZES=256 SWEEP_BLOCKS=16,64 make sweep.out`, the check has to
+# see the same values.
+SIZES = [int(x) for x in os.environ.get('SWEEP_SIZES', '128,256').split(',')]
+BLOCKS = [int(x) for x in
+          os.environ.get('SWEEP_BLOCKS', '8,16,32,64,128').split(',')]
+# variant name: application binary
+VARIANTS = {
+  'block': 'matrixmultiply_block',
+  'block_t': 'matrixmultiply_block_t',
+}
+
+
+def configs():
+  """All (variant, size, block) configurations, blocks larger than the
+  matrix are skipped."""
+  for v in VARIANTS:
+    for n in SIZES:
+      for b in BLOCKS:
+        if b <= n:
+          yield (v, n, b)
+
+
+def exp_name(v, n, b):
+  return f'sweep-{v}-{n}-{b}'
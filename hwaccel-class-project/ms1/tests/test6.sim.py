@@ -0,0 +1,43 @@
+# TEST 6: fast functional test of the optimized CPU baseline (packed SIMD
+# kernels, 4 threads on 4 cores).
+
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+import simbricks.orchestration.nodeconfig as node
+import simbricks.orchestration.experiment.experiment_environment as env
+
+class MatMulApp(node.AppConfig):
+    def __init__(self, n, it=None, threads=None):
+       super().__init__()
+       self.n = n
+       self.it = it
+       self.threads = threads
+    def run_cmds(self, node):
+        # application command to run once the host is booted up
+        cmd = f'/tmp/guest/matrixmultiply_fast {self.n}'
+        if self.it is not None:
+          cmd += f' {self.it}'
+          if self.threads is not None:
+            cmd += f' {self.threads}'
+        return [cmd]
+
+    def config_files(self, environment: env.ExpEnv):
+        # copy matrixmultiply binary into host image during prep
+        m = {'matrixmultiply_fast': open('app/matrixmultiply_fast', 'rb')}
+        return {**m, **super().config_files(environment)}
+
+e = exp.Experiment(f'test6')
+
+server_config = node.NodeConfig()
+server_config.app = MatMulApp(500)
+server_config.cores = 4
+server_config.nockp = True
+
+server = sim.Gem5Host(server_config)
+server.name = 'host'
+server.cpu_type = 'X86KvmCPU'
+
+e.add_host(server)
+server.wait = True
+
+experiments = [e]
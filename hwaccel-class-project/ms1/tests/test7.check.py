@@ -0,0 +1,30 @@
+from check_common import *
+
+test_name('test7')
+
+try:
+  for t in [1, 4]:
+    data = load_testfile(f'out/test7-{t}-1.json')
+
+    out = data['sims']['host.host']['stdout']
+    line = find_line(out, '^Cycles per operation: ([0-9]*)')
+    if not line:
+      fail('Could not find "Cycles per operation:" output')
+    cycles = int(line.group(1))
+
+    line = find_line(out,
+                     '^GOPS: naive ([0-9.]+) optimized ([0-9.]+) speedup '
+                     '([0-9.]+)')
+    if not line:
+      fail('Could not find "GOPS:" output')
+    speedup = float(line.group(3))
+    print(f'Threads={t} Cycles={cycles} GOPS naive={line.group(1)} '
+          f'optimized={line.group(2)} speedup={speedup}')
+
+    if speedup < 5:
+      fail('Optimized baseline should be at least 5x faster than naive')
+except:
+  exception_thrown()
+  fail('Parsing simulation output failed')
+
+success()
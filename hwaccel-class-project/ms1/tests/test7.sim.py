@@ -0,0 +1,44 @@
+# TEST 7: performance test of the optimized CPU baseline against the simple
+# multiplication, single-threaded on the usual single core, and with 4
+# threads on 4 cores.
+
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+import simbricks.orchestration.nodeconfig as node
+import simbricks.orchestration.experiment.experiment_environment as env
+
+class MatMulApp(node.AppConfig):
+    def __init__(self, n, it, threads):
+       super().__init__()
+       self.n = n
+       self.it = it
+       self.threads = threads
+    def run_cmds(self, node):
+        # application command to run once the host is booted up
+        return [f'/tmp/guest/matrixmultiply_fast {self.n} {self.it} '
+                f'{self.threads}']
+
+    def config_files(self, environment: env.ExpEnv):
+        # copy matrixmultiply binary into host image during prep
+        m = {'matrixmultiply_fast': open('app/matrixmultiply_fast', 'rb')}
+        return {**m, **super().config_files(environment)}
+
+experiments = []
+
+for t in [1, 4]:
+  e = exp.Experiment(f'test7-{t}')
+  e.checkpoint = True
+
+  server_config = node.NodeConfig()
+  server_config.app = MatMulApp(256, 3, t)
+  server_config.cores = t
+
+  server = sim.Gem5Host(server_config)
+  server.name = 'host'
+  server.cpu_type = 'TimingSimpleCPU'
+  server.cpu_freq = '1GHz'
+
+  e.add_host(server)
+  server.wait = True
+
+  experiments.append(e)
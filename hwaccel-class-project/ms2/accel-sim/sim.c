@@ -96,7 +96,8 @@ void MMIORead(volatile struct SimbricksProtoPcieH2DRead *read)
                         "0x%lx\n",
                 read->offset);
     }
-  } else if(read->offset < (OFF_OUT + matrix_size * matrix_size) && read->offset >= OFF_OUT) {
+  } else if(read->offset >= OFF_OUT &&
+            read->offset + read->len <= OFF_OUT + matrix_size * matrix_size) {
     src = matrix_out + (read->offset - OFF_OUT);
   } 
   else {
@@ -141,9 +142,13 @@ void MMIOWrite(volatile struct SimbricksProtoPcieH2DWrite *write)
                         "0x%lx = 0x%lx\n",
                 write->offset, val);
     }
-  } else if(write->offset < (OFF_INA + matrix_size * matrix_size) && write->offset >= OFF_INA) {
+  } else if(write->offset >= OFF_INA &&
+            write->offset + write->len <= OFF_INA + matrix_size * matrix_size) {
+    // matrix writes can be any length up to the message size, so a host that
+    // coalesces stores (write-combining) can send several stores in one write
     memcpy(matrix_a + (write->offset - OFF_INA), (const void *) write->data, write->len);
-  } else if(write->offset < (OFF_INB + matrix_size * matrix_size) && write->offset >= OFF_INB) {
+  } else if(write->offset >= OFF_INB &&
+            write->offset + write->len <= OFF_INB + matrix_size * matrix_size) {
     memcpy(matrix_b + (write->offset - OFF_INB), (const void *) write->data, write->len);
   }
   else {
@@ -37,6 +37,50 @@
 #define ACCESS_REG_BYTE(r) (*(volatile uint64_t *) ((uintptr_t) regs + r))
 
 static void *regs;
+/** Copy matrices with plain memcpy instead of mmio_copy_to/mmio_copy_from, set
+ * by MATMUL_MMIO_MEMCPY=1 in the environment for comparison. */
+static int mmio_memcpy = 0;
+
+/**
+ * Copy `len` bytes from `src` to the BAR at offset `off`, with aligned 64-bit
+ * stores where possible, so each write carries 8 bytes. A write-combining
+ * mapping can merge consecutive stores into one larger write. memcpy makes no
+ * such promise and may use byte stores (rep movsb) that each become a separate
+ * PCIe write. Only an unaligned head or tail uses byte stores.
+ */
+static void mmio_copy_to(uint64_t off, const uint8_t *src, size_t len) {
+  volatile uint8_t *dst = (volatile uint8_t *) ((uintptr_t) regs + off);
+  uint64_t v;
+
+  for (; len > 0 && ((uintptr_t) dst % 8) != 0; len--)
+    *dst++ = *src++;
+  for (; len >= 8; len -= 8) {
+    memcpy(&v, src, 8);
+    *(volatile uint64_t *) dst = v;
+    dst += 8;
+    src += 8;
+  }
+  for (; len > 0; len--)
+    *dst++ = *src++;
+}
+
+/** Copy `len` bytes from the BAR at offset `off` to `dst`, with aligned 64-bit
+ * loads where possible, so each read request returns 8 bytes. */
+static void mmio_copy_from(uint8_t *dst, uint64_t off, size_t len) {
+  volatile uint8_t *src = (volatile uint8_t *) ((uintptr_t) regs + off);
+  uint64_t v;
+
+  for (; len > 0 && ((uintptr_t) src % 8) != 0; len--)
+    *dst++ = *src++;
+  for (; len >= 8; len -= 8) {
+    v = *(volatile uint64_t *) src;
+    memcpy(dst, &v, 8);
+    dst += 8;
+    src += 8;
+  }
+  for (; len > 0; len--)
+    *dst++ = *src++;
+}
 
 int accelerator_init(void) {
   struct vfio_dev dev;
@@ -54,6 +98,10 @@ int accelerator_init(void) {
 
   // after this registers are accessible
 
+  const char *env = getenv("MATMUL_MMIO_MEMCPY");
+  if (env)
+    mmio_memcpy = atoi(env);
+
   // YOU MAY WANT ADDITIONAL INITIALIZATION CODE HERE
   return 0;
 }
@@ -74,10 +122,18 @@ void matmult_accel(const uint8_t * restrict A, const uint8_t * restrict B,
   uint64_t off_a = ACCESS_REG(REG_OFF_INA);
   uint64_t off_b = ACCESS_REG(REG_OFF_INB);
   uint64_t off_out = ACCESS_REG(REG_OFF_OUT);
-  memcpy((void *) ((uintptr_t) regs + off_a), A, n * n);
-  memcpy((void *) ((uintptr_t) regs + off_b), B, n * n);
+  if (mmio_memcpy) {
+    memcpy((void *) ((uintptr_t) regs + off_a), A, n * n);
+    memcpy((void *) ((uintptr_t) regs + off_b), B, n * n);
+  } else {
+    mmio_copy_to(off_a, A, n * n);
+    mmio_copy_to(off_b, B, n * n);
+  }
   ACCESS_REG_BYTE(REG_CTRL) = 1;
   while(ACCESS_REG_BYTE(REG_CTRL) != 0)
     ;
-  memcpy(out, (void *) ((uintptr_t) regs + off_out), n * n);
+  if (mmio_memcpy)
+    memcpy(out, (void *) ((uintptr_t) regs + off_out), n * n);
+  else
+    mmio_copy_from(out, off_out, n * n);
 }
@@ -25,18 +25,22 @@ class HwAccelNode(node.NodeConfig):
 # Actual application to run. Includes the command to run, but also makes sure
 # the compiled binary gets copied into the disk image of the simulated machine.
 class MatMulApp(node.AppConfig):
-    def __init__(self, n = None, its = None):
+    def __init__(self, n = None, its = None, memcpy = False):
         super().__init__()
         self.n = n
         self.its = its
+        # set to True to copy matrices with plain memcpy instead of aligned
+        # 8-byte stores
+        self.memcpy = memcpy
 
     def run_cmds(self, node):
+        env = 'MATMUL_MMIO_MEMCPY=1 ' if self.memcpy else ''
         if self.n is None:
-          return [f'/tmp/guest/matmul-accel']
+          return [f'{env}/tmp/guest/matmul-accel']
         elif self.its is None:
-          return [f'/tmp/guest/matmul-accel {self.n}']
+          return [f'{env}/tmp/guest/matmul-accel {self.n}']
         else:
-          return [f'/tmp/guest/matmul-accel {self.n} {self.its}']
+          return [f'{env}/tmp/guest/matmul-accel {self.n} {self.its}']
 
     def config_files(self, environment: env.ExpEnv):
         # copy binary into host image during prep
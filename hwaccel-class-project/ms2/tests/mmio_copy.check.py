@@ -0,0 +1,27 @@
+from check_common import *
+
+test_name('mmio_copy')
+
+cycle_times = {}
+
+for mode in ['memcpy', 'aligned']:
+  data = load_testfile(f'out/mmio_copy-{mode}-1.json')
+
+  try:
+    out = data['sims']['host.host']['stdout']
+    line = find_line(out, '^Cycles per operation: ([0-9]*)')
+    if not line:
+      fail('Could not find "Cycles per operation:" output')
+
+    cycles = int(line.group(1))
+    cycle_times[mode] = cycles
+    print(f'{mode} -> {cycles} Cycles/op')
+  except Exception:
+    exception_thrown()
+    fail('Parsing simulation output failed')
+
+print(f'Speedup: {cycle_times["memcpy"] / cycle_times["aligned"]:.2f}')
+if cycle_times['aligned'] > cycle_times['memcpy']:
+  fail('Copying with aligned 8-byte accesses is slower than memcpy')
+
+success()
@@ -0,0 +1,35 @@
+# MMIO COPY: Performance test for copying the matrices to and from the
+# accelerator with aligned 8-byte stores and loads (mmio_copy_to/from) versus
+# plain memcpy, for a 128x128 multiplication with a 1ns accelerator latency so
+# the copies dominate.
+
+import sys; sys.path.append('./tests/') # add tests dir to module search path
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+
+from hwaccel_common import *
+
+experiments = []
+
+for memcpy in [True, False]:
+  e = exp.Experiment(f'mmio_copy-{"memcpy" if memcpy else "aligned"}')
+  e.checkpoint = True
+
+  server_config = HwAccelNode()
+  server_config.app = MatMulApp(128, 3, memcpy)
+
+  server = sim.Gem5Host(server_config)
+  server.name = 'host'
+  server.cpu_type = 'TimingSimpleCPU'
+  server.cpu_freq = '1GHz'
+
+  hwaccel = HWAccelSim(1000, 128)
+  hwaccel.name = 'accel'
+  hwaccel.sync = True
+  server.add_pcidev(hwaccel)
+
+  e.add_pcidev(hwaccel)
+  e.add_host(server)
+  server.wait = True
+
+  experiments.append(e)
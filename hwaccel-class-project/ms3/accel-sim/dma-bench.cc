@@ -0,0 +1,290 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Micro-benchmark for the shared DMA engine (common/accel-sim/dma.h). Runs it
+ * against a loopback "host" that completes every PCIe request immediately, so
+ * the measured rate is the engine's own overhead for issuing, splitting and
+ * completing operations. Keeps DEPTH operations in flight at all times.
+ *
+ * `dma-bench mix` instead models a host link (fixed per-request cost plus
+ * 4 GB/s, requests completed in order) and runs a few latency-sensitive 64B
+ * reads next to a stream of 64KB writes, once per DMA queue arbitration
+ * setting, and prints the per-queue latencies.
+ */
+
+#include <time.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <accel-sim/dma.h>
+
+#define MAX_INFLIGHT 64
+
+/* mix experiment parameters */
+#define MIX_SMALL_SIZE 64
+#define MIX_SMALL_DEPTH 16
+#define MIX_SMALL_OPS 20000
+#define MIX_BULK_SIZE 65536
+#define MIX_BULK_DEPTH 8
+#define MIX_BULK_FLAG (1ULL << 63)
+/* host link model (picoseconds) */
+#define LINK_REQ_PS 50000
+#define LINK_BYTE_PS 250
+
+static uint64_t main_time = 0;
+
+/* loopback host the DMA engine talks to */
+struct BenchHost {
+  uint64_t Now() { return main_time; }
+  volatile union SimbricksProtoPcieD2H *PcieAlloc();
+  void PcieSend(volatile union SimbricksProtoPcieD2H *msg, uint8_t type);
+  void DmaComplete(uint64_t opaque);
+};
+using Dma = accelsim::DmaEngine<BenchHost>;
+
+static BenchHost host;
+static Dma dma(host);
+
+/* outgoing message buffer, only one message is allocated at a time */
+static union {
+  union SimbricksProtoPcieD2H msg;
+  uint8_t raw[sizeof(union SimbricksProtoPcieD2H) + 4096];
+} out_buf;
+
+/* incoming completion buffer */
+static union {
+  union SimbricksProtoPcieH2D msg;
+  uint8_t raw[sizeof(union SimbricksProtoPcieH2D) + 4096];
+} in_buf;
+
+/* PCIe requests sent by the engine and not yet completed by the "host" */
+static struct {
+  uint64_t req_id;
+  uint16_t len;
+  bool write;
+} inflight[MAX_INFLIGHT];
+static size_t inflight_num = 0;
+
+static uint8_t *data;
+static size_t op_size;
+static size_t ops_total;
+static size_t ops_issued;
+static size_t ops_done;
+
+static bool mix;
+static bool mix_shared_queue;
+static size_t bulk_issued;
+/* issue time, then latency, of each small read (picoseconds) */
+static uint64_t small_lat[MIX_SMALL_OPS];
+
+volatile union SimbricksProtoPcieD2H *BenchHost::PcieAlloc() {
+  return &out_buf.msg;
+}
+
+void BenchHost::PcieSend(volatile union SimbricksProtoPcieD2H *msg,
+    uint8_t type) {
+  if (inflight_num >= MAX_INFLIGHT) {
+    fprintf(stderr, "PcieSend: too many requests in flight\n");
+    abort();
+  }
+  inflight[inflight_num].write = type == SIMBRICKS_PROTO_PCIE_D2H_MSG_WRITE;
+  inflight[inflight_num].req_id = inflight[inflight_num].write ?
+      msg->write.req_id : msg->read.req_id;
+  inflight[inflight_num].len = inflight[inflight_num].write ?
+      msg->write.len : msg->read.len;
+  inflight_num++;
+}
+
+static void IssueSmall(void) {
+  small_lat[ops_issued] = main_time;
+  if (mix_shared_queue)
+    dma.Read(data, 0x1000, MIX_SMALL_SIZE, ops_issued, Dma::kQueueRead);
+  else
+    dma.Read(data, 0x1000, MIX_SMALL_SIZE, ops_issued);
+  ops_issued++;
+}
+
+static void IssueBulk(void) {
+  uint64_t opaque = MIX_BULK_FLAG | bulk_issued++;
+  if (mix_shared_queue)
+    dma.Write(0x100000, data, MIX_BULK_SIZE, opaque, Dma::kQueueRead);
+  else
+    dma.Write(0x100000, data, MIX_BULK_SIZE, opaque);
+}
+
+static void IssueOne(void) {
+  if (ops_issued & 1)
+    dma.Write(0x1000, data, op_size, ops_issued);
+  else
+    dma.Read(data, 0x1000, op_size, ops_issued);
+  ops_issued++;
+}
+
+void BenchHost::DmaComplete(uint64_t opaque) {
+  if (mix) {
+    if (opaque & MIX_BULK_FLAG) {
+      if (ops_done < ops_total)
+        IssueBulk();
+      return;
+    }
+    small_lat[opaque] = main_time - small_lat[opaque];
+    ops_done++;
+    if (ops_issued < ops_total)
+      IssueSmall();
+    return;
+  }
+
+  ops_done++;
+  if (ops_issued < ops_total)
+    IssueOne();
+}
+
+/* complete one in-flight request: a random one, so completions arrive out of
+ * order, or in mix mode the oldest one after it crossed the modeled link */
+static void CompleteOne(void) {
+  size_t i = mix ? 0 : (size_t) rand() % inflight_num;
+  volatile union SimbricksProtoPcieH2D *msg = &in_buf.msg;
+  uint8_t type;
+
+  if (inflight[i].write) {
+    msg->writecomp.req_id = inflight[i].req_id;
+    type = SIMBRICKS_PROTO_PCIE_H2D_MSG_WRITECOMP;
+  } else {
+    msg->readcomp.req_id = inflight[i].req_id;
+    type = SIMBRICKS_PROTO_PCIE_H2D_MSG_READCOMP;
+  }
+  if (mix) {
+    main_time += LINK_REQ_PS + LINK_BYTE_PS * inflight[0].len;
+    memmove(&inflight[0], &inflight[1], --inflight_num * sizeof(inflight[0]));
+  } else {
+    inflight[i] = inflight[--inflight_num];
+  }
+
+  dma.Complete(msg, type);
+}
+
+static void Run(size_t depth, size_t size, size_t ops) {
+  struct timespec start, end;
+
+  op_size = size;
+  ops_total = ops;
+  ops_issued = 0;
+  ops_done = 0;
+  data = static_cast<uint8_t *>(calloc(1, size));
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (ops_issued < depth && ops_issued < ops_total)
+    IssueOne();
+  while (ops_done < ops_total)
+    CompleteOne();
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  double secs = (end.tv_sec - start.tv_sec) +
+      (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("depth=%-4zu size=%-6zu ops=%zu: %.0f ops/s (%.1f ns/op)\n",
+         depth, size, ops, ops / secs, secs * 1e9 / ops);
+  free(data);
+}
+
+static int CmpU64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+  return x < y ? -1 : x > y;
+}
+
+static void RunMix(const char *name, bool shared, unsigned read_prio,
+    unsigned read_weight) {
+  unsigned q;
+  for (q = 0; q < Dma::kNumQueues; q++)
+    dma.QueueConfig(q, 0, 1);
+  dma.QueueConfig(Dma::kQueueRead, read_prio, read_weight);
+  dma.ResetStats();
+
+  mix = true;
+  mix_shared_queue = shared;
+  main_time = 0;
+  ops_total = MIX_SMALL_OPS;
+  ops_issued = 0;
+  ops_done = 0;
+  bulk_issued = 0;
+  data = static_cast<uint8_t *>(calloc(1, MIX_BULK_SIZE));
+
+  for (q = 0; q < MIX_BULK_DEPTH; q++)
+    IssueBulk();
+  for (q = 0; q < MIX_SMALL_DEPTH; q++)
+    IssueSmall();
+  while (inflight_num > 0)
+    CompleteOne();
+
+  uint64_t sum = 0;
+  for (q = 0; q < MIX_SMALL_OPS; q++)
+    sum += small_lat[q];
+  qsort(small_lat, MIX_SMALL_OPS, sizeof(small_lat[0]), CmpU64);
+
+  printf("%s: %zu reads, %zu writes in %.1fus\n", name, ops_done, bulk_issued,
+         main_time / 1e6);
+  printf("  reads: avg=%.1fns p50=%.1fns p99=%.1fns max=%.1fns\n",
+         sum / 1000.0 / MIX_SMALL_OPS, small_lat[MIX_SMALL_OPS / 2] / 1000.0,
+         small_lat[MIX_SMALL_OPS * 99 / 100] / 1000.0,
+         small_lat[MIX_SMALL_OPS - 1] / 1000.0);
+  dma.PrintStats(stdout);
+  free(data);
+  mix = false;
+}
+
+int main(int argc, char *argv[]) {
+  static const size_t depths[] = {1, 16, 64, 256};
+  static const size_t sizes[] = {8, 64, 4096, 65536};
+  size_t ops = 1000000;
+
+  if (argc == 2 && !strcmp(argv[1], "mix")) {
+    RunMix("fifo (shared queue)", true, 0, 1);
+    RunMix("round-robin", false, 0, 1);
+    RunMix("weighted round-robin (reads 4:1)", false, 0, 4);
+    RunMix("strict priority (reads first)", false, 1, 1);
+    return 0;
+  }
+
+  if (argc > 4) {
+    fprintf(stderr, "Usage: dma-bench [DEPTH] [OP-SIZE] [OPS]\n"
+            "       dma-bench mix\n");
+    return EXIT_FAILURE;
+  }
+  if (argc >= 4)
+    ops = strtoull(argv[3], NULL, 0);
+
+  if (argc >= 3) {
+    Run(strtoull(argv[1], NULL, 0), strtoull(argv[2], NULL, 0), ops);
+    return 0;
+  }
+
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++)
+      if (argc < 2 || depths[d] == strtoull(argv[1], NULL, 0))
+        Run(depths[d], sizes[s], ops / (1 + sizes[s] / 4096));
+  return 0;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ACCEL_SIM_REGS_H_
+#define ACCEL_SIM_REGS_H_
+
+/*
+ * Register layout of the accelerator. Both the simulator's MMIO dispatch
+ * (sim.cc) and the REG_* offsets in common/reg_map.h for the driver are
+ * generated from this table (make common/reg_map.h), so registers only need
+ * to be added or moved here.
+ */
+
+#include <accel-sim/regmap.h>
+
+using accelsim::Access;
+
+static constexpr accelsim::RegInfo kRegInfo[] = {
+  {"SIZE", 0x00, 8, Access::kRW,
+   "Size register: contains supported matrix size (width/height)."},
+  {"CTRL", 0x08, 8, Access::kRW,
+   "Control register: used to start the accelerator/wait for completion."},
+
+  {"OFF_INA", 0x10, 8, Access::kRO,
+   "Offset of the first input matrix in the accelerator memory."},
+  {"OFF_INB", 0x18, 8, Access::kRO,
+   "Offset of the second input matrix in the accelerator memory."},
+  {"OFF_OUT", 0x20, 8, Access::kRO,
+   "Offset of the output matrix in the accelerator memory."},
+
+  {"MEM_SIZE", 0x30, 8, Access::kRO,
+   "Register containing size of the on-accelerator memory."},
+  {"MEM_OFF", 0x38, 8, Access::kRO,
+   "Register containing offset of the accelerator memory."},
+
+  {"DMA_CTRL", 0x40, 8, Access::kRW, "DMA Control register."},
+  {"DMA_LEN", 0x48, 8, Access::kRW,
+   "Register holding requested length of the DMA operation in bytes."},
+  {"DMA_ADDR", 0x50, 8, Access::kRW,
+   "Register holding *physical* address on the host."},
+  {"DMA_OFF", 0x58, 8, Access::kRW,
+   "Register holding memory offset on the accelerator."},
+
+  {"DMA_SG_ADDR", 0x60, 8, Access::kRW,
+   "Register holding the *physical* address of the descriptor list."},
+  {"DMA_SG_COUNT", 0x68, 8, Access::kWO,
+   "Doorbell: number of descriptors in the list at REG_DMA_SG_ADDR."},
+};
+
+#endif  // ndef ACCEL_SIM_REGS_H_
@@ -22,16 +22,20 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include <stdbool.h>
-#include <stdint.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #include <simbricks/pcie/if.h>
 
+extern "C" {
 #include "sim.h"
 #include "../common/reg_defs.h"
+}
+
+#include "regs.h"
 
 // uncomment to enable debug prints
 //#define DEBUG
@@ -60,8 +64,16 @@ uint64_t dma_addr;
 uint64_t dma_len;
 uint64_t dma_off;
 
+/* scatter-gather list being fetched or run, sg_next is the next descriptor */
+#define SG_MAX 64
+uint64_t dma_sg_addr;
+static struct dma_desc sg_list[SG_MAX];
+static uint64_t sg_count;
+static uint64_t sg_next;
+static bool sg_op;  /* matrix operation started from the list */
+
 int InitState(void) {
-  if (!(mem = calloc(1, mem_size)))
+  if (!(mem = (uint8_t *) calloc(1, mem_size)))
     return -1;
 
   ctrl = 0;
@@ -77,6 +89,94 @@ int InitState(void) {
   return 0;
 }
 
+static void StartOp(void) {
+  ctrl = 1;
+  expected_time = main_time + op_latency;
+}
+
+/* run the next descriptor of the list, or finish the list */
+static void SGStep(void) {
+  if (sg_next >= sg_count) {
+    sg_count = 0;
+    dma_ctrl = 0;
+    return;
+  }
+
+  struct dma_desc *d = &sg_list[sg_next++];
+  if (d->ctrl & REG_DMA_CTRL_OP) {
+    sg_op = true;
+    StartOp();
+  } else if (d->ctrl & REG_DMA_CTRL_W) {
+    IssueDMAWrite(d->addr, mem + d->off, d->len, 0);
+  } else {
+    IssueDMARead(mem + d->off, d->addr, d->len, 0);
+  }
+}
+
+/******************************************************************************/
+/* Register accesses: the layout is in regs.h, below are the read and write
+   operations of each register */
+
+using accelsim::FieldOps;
+using accelsim::NoDev;
+using accelsim::RegOps;
+
+static NoDev nodev;
+
+// FILL ME IN
+// THIS PROBABLY NEEDS CHANGES BEYOND THE REGISTER OPERATIONS
+
+static void WriteCtrl(NoDev &, unsigned, uint64_t val) {
+  if (val && !ctrl)
+    StartOp();
+}
+
+static void WriteDmaCtrl(NoDev &, unsigned, uint64_t val) {
+  dma_ctrl = val;
+  dma_ctrl_run = val & REG_DMA_CTRL_RUN;
+  dma_ctrl_w = val & REG_DMA_CTRL_W;
+  if (dma_ctrl_run) {
+    if (dma_ctrl_w) {
+      IssueDMAWrite(dma_addr, mem + dma_off, dma_len, 0);
+    } else {
+      IssueDMARead(mem + dma_off, dma_addr, dma_len, 0);
+    }
+  }
+}
+
+static void WriteDmaSgCount(NoDev &, unsigned, uint64_t val) {
+  if (dma_ctrl_run || sg_count || !val || val > SG_MAX) {
+    fprintf(stderr, "MMIO Write: warning dropping DMA list of %lu\n", val);
+    return;
+  }
+  sg_count = val;
+  sg_next = 0;
+  dma_ctrl = REG_DMA_CTRL_RUN;
+  IssueDMARead(sg_list, dma_sg_addr, val * sizeof(sg_list[0]), 0);
+}
+
+#define FIELD(x) FieldOps<NoDev, &x>::Read, FieldOps<NoDev, &x>::Write
+
+static constexpr RegOps<NoDev> kRegOps[] = {
+  {"SIZE", FIELD(matrix_size)},
+  {"CTRL", FieldOps<NoDev, &ctrl>::Read, WriteCtrl},
+  {"OFF_INA", FieldOps<NoDev, &OFF_INA>::Read, nullptr},
+  {"OFF_INB", FieldOps<NoDev, &OFF_INB>::Read, nullptr},
+  {"OFF_OUT", FieldOps<NoDev, &OFF_OUT>::Read, nullptr},
+  {"MEM_SIZE", FieldOps<NoDev, &mem_size>::Read, nullptr},
+  {"MEM_OFF", nullptr, nullptr},
+  {"DMA_CTRL", FieldOps<NoDev, &dma_ctrl>::Read, WriteDmaCtrl},
+  {"DMA_LEN", FIELD(dma_len)},
+  {"DMA_ADDR", FIELD(dma_addr)},
+  {"DMA_OFF", FIELD(dma_off)},
+  {"DMA_SG_ADDR", FIELD(dma_sg_addr)},
+  {"DMA_SG_COUNT", nullptr, WriteDmaSgCount},
+};
+
+#undef FIELD
+
+static constexpr auto kRegs = accelsim::MakeRegMap<kRegInfo, kRegOps>();
+
 void MMIORead(volatile struct SimbricksProtoPcieH2DRead *read)
 {
 #ifdef DEBUG
@@ -92,40 +192,18 @@ void MMIORead(volatile struct SimbricksProtoPcieH2DRead *read)
   // zero it out in case of bad register
   memset((void *) rc->data, 0, read->len);
 
-  void *src = NULL;
-
-  // FILL ME IN
-  // THIS PROBABLY NEEDS CHANGES BEYOND SWTICH CASES
-
-  if (read->offset < 256) {
-    assert(read->len <= 8);
-    assert(read->offset % read->len == 0);
-    switch (read->offset) {
-      case REG_SIZE: src = &matrix_size; break;
-      case REG_MEM_SIZE: src = &mem_size; break;
-      case REG_OFF_INA: src = &OFF_INA; break;
-      case REG_OFF_INB: src = &OFF_INB; break;
-      case REG_OFF_OUT: src = &OFF_OUT; break;
-      case REG_CTRL: src = &ctrl; break;
-      case REG_DMA_CTRL: src = &dma_ctrl; break;
-      case REG_DMA_ADDR: src = &dma_addr; break;
-      case REG_DMA_LEN: src = &dma_len; break;
-      case REG_DMA_OFF: src = &dma_off; break;
-      default:
-        fprintf(stderr, "MMIO Read: warning read from invalid register "
-                        "0x%lx\n",
-                read->offset);
-    }
-  } else if(read->offset < (OFF_OUT + matrix_size * matrix_size) && read->offset >= OFF_OUT) {
-    src = matrix_out + (read->offset - OFF_OUT);
+  uint64_t val;
+  if (kRegs.Read(nodev, read->offset, read->len, val)) {
+    memcpy((void *) rc->data, &val, read->len);
+  } else if (read->offset < (OFF_OUT + matrix_size * matrix_size) &&
+             read->offset >= OFF_OUT) {
+    memcpy((void *) rc->data, matrix_out + (read->offset - OFF_OUT),
+           read->len);
   } else {
     fprintf(stderr, "MMIO Read: warning invalid MMIO read 0x%lx\n",
           read->offset);
   }
 
-  if (src)
-    memcpy((void *) rc->data, src, read->len);
-
   // send response
   SendPcieOut(msg, SIMBRICKS_PROTO_PCIE_D2H_MSG_READCOMP);
 }
@@ -137,54 +215,12 @@ void MMIOWrite(volatile struct SimbricksProtoPcieH2DWrite *write)
     write->offset, write->len);
 #endif
 
-  // FILL ME IN
-  // THIS PROBABLY NEEDS CHANGES BEYOND SWTICH CASES
-
-  void *dst = NULL;
-  if (write->offset < 256) {
-    assert(write->len <= 8);
-    assert(write->offset % write->len == 0);
-    uint64_t val = 0;
+  uint64_t val = 0;
+  if (write->len <= 8)
     memcpy(&val, (const void *) write->data, write->len);
-    switch (write->offset) {
-      case REG_SIZE:
-        matrix_size = val;
-        break;
-      case REG_CTRL:
-        if(val && !ctrl){
-          ctrl = 1;
-          expected_time = main_time + op_latency;
-        }
-        break;
-      case REG_DMA_CTRL:
-        dma_ctrl = val;
-        dma_ctrl_run = val & REG_DMA_CTRL_RUN;
-        dma_ctrl_w = val & REG_DMA_CTRL_W;
-        if(dma_ctrl_run){
-          if(dma_ctrl_w){
-            IssueDMAWrite(dma_addr, mem + dma_off, dma_len, 0);
-          } else {
-            IssueDMARead(mem + dma_off, dma_addr, dma_len, 0);
-          }
-        }
-        break;
-      case REG_DMA_ADDR:
-        dma_addr = val;
-        break;
-      case REG_DMA_LEN:
-        dma_len = val;
-        break;
-      case REG_DMA_OFF:
-        dma_off = val;
-        break;
-      default:
-        fprintf(stderr, "MMIO Write: warning write to invalid register 0x%lx\n",
-          write->offset);
-    }
-  } else {
+  if (!kRegs.Write(nodev, write->offset, write->len, val))
     fprintf(stderr, "MMIO Write: warning invalid MMIO write 0x%lx\n",
           write->offset);
-  }
 }
 
 void PollEvent(void) {
@@ -200,6 +236,10 @@ void PollEvent(void) {
     }
     ctrl = 0;
     expected_time = UINT64_MAX;
+    if (sg_op) {
+      sg_op = false;
+      SGStep();
+    }
   }
 }
 
@@ -211,6 +251,11 @@ uint64_t NextEvent(void) {
 }
 
 void DMACompleteEvent(uint64_t opaque) {
+  if (sg_count) {
+    SGStep();
+    return;
+  }
+
   dma_ctrl = 0;
   dma_ctrl_run = 0;
   dma_ctrl_w = 0;
@@ -74,9 +74,34 @@ void IssueDMARead(void *dst, uint64_t src_addr, size_t len, uint64_t opaque);
 void IssueDMAWrite(uint64_t dst_addr, const void *src, size_t len,
     uint64_t opaque);
 
+/** Number of DMA issue queues. `IssueDMARead` and `IssueDMAWrite` use
+ *  DMA_QUEUE_READ and DMA_QUEUE_WRITE respectively. */
+#define DMA_NUM_QUEUES 4
+#define DMA_QUEUE_READ 0
+#define DMA_QUEUE_WRITE 1
+
+/** Same as `IssueDMARead`, but queue the operation on DMA queue `queue`. */
+void IssueDMAReadQ(unsigned queue, void *dst, uint64_t src_addr, size_t len,
+    uint64_t opaque);
+
+/** Same as `IssueDMAWrite`, but queue the operation on DMA queue `queue`. */
+void IssueDMAWriteQ(unsigned queue, uint64_t dst_addr, const void *src,
+    size_t len, uint64_t opaque);
+
+/**
+ * Configure arbitration for a DMA queue. Pending DMA credits go to the
+ * non-empty queues with the highest priority first, queues with the same
+ * priority take turns issuing up to `weight` sub-operations each (weighted
+ * round-robin). All queues start with priority 0 and weight 1.
+ * @param queue    Queue number (< DMA_NUM_QUEUES).
+ * @param prio     Priority, higher is served first.
+ * @param weight   Round-robin weight, must be at least 1.
+ */
+void DMAQueueConfig(unsigned queue, unsigned prio, unsigned weight);
+
 
 /******************************************************************************/
-/* Functions you will implement in sim.c */
+/* Functions you will implement in sim.cc */
 
 /**
  * Called once during initialization. Use this to initialize your internal
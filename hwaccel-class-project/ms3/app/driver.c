@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <vfio-pci.h>
 #include <dma-alloc.h>
@@ -47,6 +48,11 @@ static uintptr_t dma_mem_phys;
 static uint8_t *dma_mem_w;
 static uintptr_t dma_mem_phys_w;
 
+/* descriptor list for one multiplication, at the end of the input half */
+#define DMA_LIST_LEN 4
+static volatile struct dma_desc *dma_list;
+static uintptr_t dma_list_phys;
+
 int accelerator_init(bool dma) {
   struct vfio_dev dev;
   size_t reg_len;
@@ -75,6 +81,8 @@ int accelerator_init(bool dma) {
 
     dma_mem_w = (uint8_t *) dma_mem + (dma_mem_size / 2);
     dma_mem_phys_w = dma_mem_phys + (dma_mem_size / 2);
+    dma_list = (volatile struct dma_desc *) dma_mem_w - DMA_LIST_LEN;
+    dma_list_phys = dma_mem_phys_w - DMA_LIST_LEN * sizeof(struct dma_desc);
 
     if (vfio_busmaster_enable(&dev)) {
       fprintf(stderr, "Enabling busmastering failed\n");
@@ -91,6 +99,13 @@ int accelerator_matrix_size(void) {
   return ACCESS_REG(REG_SIZE);
 }
 
+static inline void dma_list_set(size_t i, uint64_t addr, uint64_t off,
+                                uint64_t len, uint64_t ctrl) {
+  dma_list[i].addr = addr;
+  dma_list[i].off = off;
+  dma_list[i].len = len;
+  dma_list[i].ctrl = ctrl;
+}
 
 void matmult_accel(const uint8_t * restrict A, const uint8_t * restrict B,
                    uint8_t * restrict out, size_t n) {
@@ -102,30 +117,18 @@ void matmult_accel(const uint8_t * restrict A, const uint8_t * restrict B,
   uint64_t off_b = ACCESS_REG(REG_OFF_INB);
   uint64_t off_out = ACCESS_REG(REG_OFF_OUT);
   
+  /* A and B go into the dma-able region side by side, and the device runs
+     the whole multiplication from one descriptor list: both loads, the
+     operation, and the output transfer, with a single doorbell. */
   memcpy(dma_mem, A, n * n);
-  ACCESS_REG(REG_DMA_ADDR) = dma_mem_phys;
-  ACCESS_REG(REG_DMA_LEN) = n * n;
-  ACCESS_REG(REG_DMA_OFF) = off_a;
-  ACCESS_REG_BYTE(REG_DMA_CTRL) = REG_DMA_CTRL_RUN;
-  while (ACCESS_REG_BYTE(REG_DMA_CTRL) & REG_DMA_CTRL_RUN)
-    ;
-
-  memcpy(dma_mem, B, n * n);
-  ACCESS_REG(REG_DMA_ADDR) = dma_mem_phys;
-  ACCESS_REG(REG_DMA_LEN) = n * n;
-  ACCESS_REG(REG_DMA_OFF) = off_b;
-  ACCESS_REG_BYTE(REG_DMA_CTRL) = REG_DMA_CTRL_RUN;
-  while (ACCESS_REG_BYTE(REG_DMA_CTRL) & REG_DMA_CTRL_RUN)
-    ;
-
-  ACCESS_REG_BYTE(REG_CTRL) = 1;
-  while(ACCESS_REG_BYTE(REG_CTRL) != 0)
-    ;
-
-  ACCESS_REG(REG_DMA_ADDR) = dma_mem_phys_w;
-  ACCESS_REG(REG_DMA_LEN) = n * n;
-  ACCESS_REG(REG_DMA_OFF) = off_out;
-  ACCESS_REG_BYTE(REG_DMA_CTRL) = REG_DMA_CTRL_RUN | REG_DMA_CTRL_W;
+  memcpy(dma_mem + n * n, B, n * n);
+  dma_list_set(0, dma_mem_phys, off_a, n * n, 0);
+  dma_list_set(1, dma_mem_phys + n * n, off_b, n * n, 0);
+  dma_list_set(2, 0, 0, 0, REG_DMA_CTRL_OP);
+  dma_list_set(3, dma_mem_phys_w, off_out, n * n, REG_DMA_CTRL_W);
+
+  ACCESS_REG(REG_DMA_SG_ADDR) = dma_list_phys;
+  ACCESS_REG(REG_DMA_SG_COUNT) = DMA_LIST_LEN;
   while (ACCESS_REG_BYTE(REG_DMA_CTRL) & REG_DMA_CTRL_RUN)
     ;
 
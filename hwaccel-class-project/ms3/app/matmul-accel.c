@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <matmul-cpu.h>
 #include <utils.h>
 
 #include "driver.h"
@@ -79,6 +80,30 @@ void test_functionality(size_t n)
     printf("STATUS: Failure Matrices do not match\n");
 }
 
+/* Time the optimized CPU multiplication (matmult_cpu) on the same inputs, the
+   baseline the accelerator has to beat. It takes a while in timing
+   simulation, MATMUL_BASELINE=0 skips it. */
+void measure_baseline(const uint8_t *A, const uint8_t *B, uint8_t *out,
+                      size_t n, size_t iterations, uint64_t accel_cycles)
+{
+  const char *env = getenv("MATMUL_BASELINE");
+  if (env && !atoi(env))
+    return;
+
+  size_t i;
+  uint64_t total_cycles = 0;
+  for (i = 0; i < iterations; i++) {
+    uint64_t start = rdtsc();
+    matmult_cpu(A, B, out, n, 0);
+    total_cycles += rdtsc() - start;
+  }
+
+  uint64_t cycles = total_cycles / iterations;
+  printf("CPU baseline cycles per operation: %ld\n", cycles);
+  if (accel_cycles)
+    printf("Speedup over CPU baseline: %.2f\n", (double) cycles / accel_cycles);
+}
+
 void measure(size_t n, size_t iterations)
 {
   uint8_t *A = rand_matrix_alloc(n, n);
@@ -94,6 +119,7 @@ void measure(size_t n, size_t iterations)
   }
 
   printf("Cycles per operation: %ld\n", total_cycles / iterations);
+  measure_baseline(A, B, out, n, iterations, total_cycles / iterations);
 }
 
 int main(int argc, char *argv[])
@@ -0,0 +1,28 @@
+from check_common import *
+
+test_name('dma_sweep')
+
+cycle_times = {}
+
+for mtu in [128, 256, 1024, 4096]:
+  for credits in [1, 4, 16, 64]:
+    data = load_testfile(f'out/dma_sweep-{mtu}-{credits}-1.json')
+
+    try:
+      out = data['sims']['host.host']['stdout']
+      line = find_line(out, '^Cycles per operation: ([0-9]*)')
+      if not line:
+        fail('Could not find "Cycles per operation:" output')
+
+      cycles = int(line.group(1))
+      cycle_times[(mtu, credits)] = cycles
+      print(f'MTU {mtu:4} credits {credits:2} -> {cycles} Cycles/op')
+    except Exception:
+      exception_thrown()
+      fail('Parsing simulation output failed')
+
+if cycle_times[(4096, 64)] > cycle_times[(128, 1)]:
+  fail('Largest payload size and credit limit should not be slower than the '
+      'smallest')
+
+success()
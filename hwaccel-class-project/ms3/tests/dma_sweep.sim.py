@@ -0,0 +1,38 @@
+# DMA SWEEP: Throughput of the DMA-based matrix multiply as a function of the
+# PCIe DMA model parameters: max payload size per request (MTU) and the number
+# of outstanding request credits. Not part of `make test`, run with
+# `make sweep`. Expect this to take about 20 minutes.
+
+import sys; sys.path.append('./tests/') # add tests dir to module search path
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+
+from hwaccel_common import *
+
+experiments = []
+
+for mtu in [128, 256, 1024, 4096]:
+  for credits in [1, 4, 16, 64]:
+    e = exp.Experiment(f'dma_sweep-{mtu}-{credits}')
+    e.checkpoint = True
+
+    server_config = HwAccelNode()
+    server_config.app = MatMulApp(128, 2, dma=True)
+
+    server = sim.Gem5Host(server_config)
+    server.name = 'host'
+    server.cpu_type = 'TimingSimpleCPU'
+    server.cpu_freq = '1GHz'
+
+    hwaccel = HWAccelSim(1000, 128, 6 * 128 * 128)
+    hwaccel.name = 'accel'
+    hwaccel.sync = True
+    hwaccel.dma_mtu = mtu
+    hwaccel.dma_credits = credits
+    server.add_pcidev(hwaccel)
+
+    e.add_pcidev(hwaccel)
+    e.add_host(server)
+    server.wait = True
+
+    experiments.append(e)
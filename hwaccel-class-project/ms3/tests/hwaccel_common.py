@@ -49,6 +49,12 @@ class MatMulApp(node.AppConfig):
 class HWAccelSim(sim.PCIDevSim):
     sync = True
 
+    # PCIe DMA model parameters, None keeps the simulator default
+    dma_mtu = None        # max payload size per DMA request (bytes, <= 4096)
+    dma_credits = None    # max outstanding DMA requests (<= 256)
+    dma_issue_lat = None  # fixed issue latency per DMA operation (ps)
+    dma_bw = None         # DMA request bandwidth cap (MB/s)
+
     def __init__(self, op_latency, matrix_size, mem_size):
         super().__init__()
         self.op_latency = op_latency
@@ -59,4 +65,13 @@ class HWAccelSim(sim.PCIDevSim):
         cmd = '%s%s %d %d %d %s %s' % \
             (os.getcwd(), '/accel-sim/sim', self.op_latency, self.matrix_size,
              self.mem_size, env.dev_pci_path(self), env.dev_shm_path(self))
-        return cmd
+        return cmd + self.dma_args()
+
+    def dma_args(self):
+        args = ''
+        for opt, val in [('mtu', self.dma_mtu), ('credits', self.dma_credits),
+                         ('issue-lat', self.dma_issue_lat),
+                         ('bw', self.dma_bw)]:
+            if val is not None:
+                args += f' --dma-{opt}={val}'
+        return args
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Simulation harness: the PCIe connection, simulation loop, and DMA engine
+ * come from the shared framework in common/accel-sim. This file only wires
+ * up the callbacks in sim.h. No need to modify this.
+ */
+
+extern "C" {
+#include "sim.h"
+}
+
+#include <accel-sim/legacy.h>
+
+int main(int argc, char *argv[]) {
+  static const accelsim::LegacyConfig cfg = {
+    "[--window=N] OP-LATENCY MATRIX-SIZE MEM-SIZE",
+    {&op_latency, &matrix_size, &mem_size},
+    3,
+    true,
+    NULL,
+    ParseOption,
+  };
+  return accelsim::LegacyMain(argc, argv, cfg);
+}
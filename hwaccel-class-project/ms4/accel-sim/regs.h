@@ -0,0 +1,74 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef ACCEL_SIM_REGS_H_
+#define ACCEL_SIM_REGS_H_
+
+/*
+ * Register layout of the accelerator. Both the simulator's MMIO dispatch
+ * (sim.cc) and the REG_* offsets in common/reg_map.h for the driver are
+ * generated from this table (make common/reg_map.h), so registers only need
+ * to be added or moved here.
+ */
+
+#include <accel-sim/regmap.h>
+
+using accelsim::Access;
+
+static constexpr accelsim::RegInfo kRegInfo[] = {
+  {"SIZE", 0x00, 8, Access::kRO,
+   "Size register: contains supported matrix size (width/height)."},
+  {"MEM_SIZE", 0x08, 8, Access::kRO,
+   "Register containing size of the on-accelerator memory."},
+
+  {"REQ_BASE", 0x10, 8, Access::kRW,
+   "Physical start address of the request queue in host memory."},
+  {"REQ_LEN", 0x18, 8, Access::kRW,
+   "Length of the request queue (# of entries), at least 1. Writing it "
+   "resets the queue to empty, and is ignored while requests are "
+   "outstanding."},
+  {"REQ_TAIL", 0x20, 8, Access::kRW,
+   "Index of the next queue entry SW will write to."},
+  {"REQ_HEAD", 0x28, 8, Access::kRO,
+   "Index of the next queue entry the device will fetch. Entries before it "
+   "(up to the tail) have been fetched and can be reused by SW."},
+
+  {"RES_BASE", 0x30, 8, Access::kRW,
+   "Physical start address of the response queue in host memory."},
+  {"RES_LEN", 0x38, 8, Access::kRW,
+   "Length of the response queue (# of entries), at least 1. Writing it "
+   "resets the queue to empty, and is ignored while requests are "
+   "outstanding."},
+
+  {"IRQ_COAL_COUNT", 0x40, 8, Access::kRW,
+   "Interrupt coalescing: the device sends MSI vector 0 once this many "
+   "responses have been written since the last interrupt. 0 disables "
+   "interrupts."},
+  {"IRQ_COAL_DELAY", 0x48, 8, Access::kRW,
+   "Interrupt coalescing: max. time in ns from the first response written "
+   "after the last interrupt until the device sends the next one, even if "
+   "fewer than REG_IRQ_COAL_COUNT responses are pending."},
+};
+
+#endif  // ndef ACCEL_SIM_REGS_H_
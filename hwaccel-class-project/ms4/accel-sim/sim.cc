@@ -0,0 +1,545 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <simbricks/pcie/if.h>
+
+extern "C" {
+#include "sim.h"
+#include "../common/reg_defs.h"
+}
+
+#include "regs.h"
+
+// uncomment to enable debug prints
+//#define DEBUG
+#ifdef DEBUG
+#define dprintf(x...) do { \
+    fprintf(stderr, "DEBUG [%lu]: ", main_time); \
+    fprintf(stderr, x); \
+  } while (0)
+#else
+#define dprintf(...) do { } while (0)
+#endif
+
+/* Configuration parameters */
+uint64_t op_latency;
+uint64_t matrix_size;
+uint64_t mem_size;
+
+/* on-accelerator memory */
+static uint8_t *mem;
+
+/* queue registers */
+static uint64_t req_base;
+static uint64_t req_len;
+static uint64_t req_tail;
+static uint64_t res_base;
+static uint64_t res_len;
+
+/* index of the next request queue entry to fetch */
+static uint64_t req_head;
+/* index of the next response queue entry to write */
+static uint64_t res_tail;
+
+/* Fetched requests. Requests are fetched in batches of up to FETCH_BATCH
+   entries with one DMA read, and the next batch is fetched while the previous
+   ones execute. cache_head and cache_tail count entries retired and fetched,
+   and are only used modulo REQ_CACHE. */
+#define FETCH_BATCH 16
+#define REQ_CACHE (2 * FETCH_BATCH)
+static union req_entry req_cache[REQ_CACHE];
+static uint64_t cache_head;
+static uint64_t cache_tail;
+static bool fetching;
+static uint64_t fetch_num;
+
+/* Response entries being written to the host. The DMA engine reads the source
+   buffer until the write completes, so each response keeps its buffer until
+   then. */
+#define RES_BUFS 8
+static struct res_entry res_bufs[RES_BUFS];
+static uint64_t res_issued;
+static unsigned res_pending;
+
+/* Requests execute out of order on three units, one request per unit at a
+   time. A request can start once its unit is free and it does not conflict
+   with an older request that has not completed yet: two requests conflict
+   if they access overlapping ranges of accelerator memory and at least one of
+   them writes. Requests retire in order, so a response for a request means
+   it and all requests before it are complete. */
+enum unit {
+  UNIT_DMA_READ,
+  UNIT_DMA_WRITE,
+  UNIT_COMPUTE,
+  NUM_UNITS,
+};
+static bool unit_busy[NUM_UNITS];
+
+enum req_state {
+  RS_WAITING,  /* not started */
+  RS_RUNNING,  /* executing on a unit */
+  RS_DONE,     /* complete, waiting to retire */
+};
+static enum req_state req_states[REQ_CACHE];
+
+/* number of requests from cache_head considered for issue, 1 executes
+   requests strictly in order */
+static uint64_t window = REQ_CACHE;
+
+/* request computing, and time the compute operation completes */
+static uint64_t compute_req;
+static uint64_t compute_done;
+
+/* Interrupt coalescing registers. irq_pending counts responses written since
+   the last interrupt, and irq_deadline is when the first of them has waited
+   the maximum delay. */
+static uint64_t irq_coal_count;
+static uint64_t irq_coal_delay;
+static uint64_t irq_pending;
+static uint64_t irq_deadline;
+
+/* DMA types, passed as opaque value with the cache index above */
+#define DMA_FETCH 1
+#define DMA_DATA 2
+#define DMA_RESPONSE 3
+#define DMA_TYPE_MASK 0xff
+#define DMA_IDX_SHIFT 8
+
+/* range of accelerator memory accessed by a request */
+struct mem_range {
+  uint64_t off;
+  uint64_t len;
+  bool write;
+};
+
+static void Step(void);
+
+int InitState(void) {
+  if (!(mem = (uint8_t *) calloc(1, mem_size)))
+    return -1;
+  return 0;
+}
+
+int ParseOption(const char *opt) {
+  if (!strncmp(opt, "window=", 7)) {
+    window = strtoull(opt + 7, NULL, 0);
+    if (window < 1 || window > REQ_CACHE) {
+      fprintf(stderr, "--window must be between 1 and %d\n", REQ_CACHE);
+      return -1;
+    }
+  } else {
+    fprintf(stderr, "unknown option --%s\n", opt);
+    return -1;
+  }
+  return 0;
+}
+
+/* fetch the next batch of requests if any and there is room in the cache */
+static void FetchRequests(void) {
+  if (fetching || !req_len || req_head == req_tail)
+    return;
+
+  uint64_t num = (req_tail + req_len - req_head) % req_len;
+  // don't wrap around the end of the request queue or the cache
+  if (num > req_len - req_head)
+    num = req_len - req_head;
+  if (num > REQ_CACHE - cache_tail % REQ_CACHE)
+    num = REQ_CACHE - cache_tail % REQ_CACHE;
+  if (num > REQ_CACHE - (cache_tail - cache_head))
+    num = REQ_CACHE - (cache_tail - cache_head);
+  if (num > FETCH_BATCH)
+    num = FETCH_BATCH;
+  if (!num)
+    return;
+
+  dprintf("fetching %lu requests at %lu\n", num, req_head);
+  fetching = true;
+  fetch_num = num;
+  IssueDMARead(&req_cache[cache_tail % REQ_CACHE],
+               req_base + req_head * sizeof(union req_entry),
+               num * sizeof(union req_entry), DMA_FETCH);
+}
+
+/* check that an access to accelerator memory is in bounds */
+static bool MemValid(const union req_entry *req, uint64_t off, uint64_t len) {
+  if (off > mem_size || len > mem_size - off) {
+    fprintf(stderr, "warning: request %u accesses invalid memory range "
+                    "0x%lx-0x%lx\n",
+            req->hdr.req_id, off, off + len);
+    return false;
+  }
+  return true;
+}
+
+/* unit executing a request, NUM_UNITS for invalid requests */
+static enum unit ReqUnit(const union req_entry *req) {
+  switch (req->hdr.type) {
+    case REQ_TYPE_DMAREAD: return UNIT_DMA_READ;
+    case REQ_TYPE_DMAWRITE: return UNIT_DMA_WRITE;
+    case REQ_TYPE_COMPUTE: return UNIT_COMPUTE;
+    default: return NUM_UNITS;
+  }
+}
+
+/* memory ranges accessed by a request, returns the number of ranges */
+static unsigned ReqRanges(const union req_entry *req, struct mem_range *r) {
+  uint64_t tile = matrix_size * matrix_size;
+  switch (req->hdr.type) {
+    case REQ_TYPE_DMAREAD:
+      r[0] = (struct mem_range) {req->dma.mem_off, req->dma.len, true};
+      return 1;
+    case REQ_TYPE_DMAWRITE:
+      r[0] = (struct mem_range) {req->dma.mem_off, req->dma.len, false};
+      return 1;
+    case REQ_TYPE_COMPUTE:
+      r[0] = (struct mem_range) {req->compute.off_ina, tile, false};
+      r[1] = (struct mem_range) {req->compute.off_inb, tile, false};
+      r[2] = (struct mem_range) {req->compute.off_out, tile, true};
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+static bool Conflict(const union req_entry *a, const union req_entry *b) {
+  struct mem_range ra[3], rb[3];
+  unsigned na = ReqRanges(a, ra), nb = ReqRanges(b, rb);
+  for (unsigned i = 0; i < na; i++) {
+    for (unsigned j = 0; j < nb; j++) {
+      if ((ra[i].write || rb[j].write) &&
+          ra[i].off < rb[j].off + rb[j].len &&
+          rb[j].off < ra[i].off + ra[i].len)
+        return true;
+    }
+  }
+  return false;
+}
+
+/* can request `idx` start without violating the order of memory accesses? */
+static bool CanStart(uint64_t idx) {
+  const union req_entry *req = &req_cache[idx % REQ_CACHE];
+  for (uint64_t i = cache_head; i < idx; i++) {
+    if (req_states[i % REQ_CACHE] != RS_DONE &&
+        Conflict(&req_cache[i % REQ_CACHE], req))
+      return false;
+  }
+  return true;
+}
+
+static void Compute(const union req_entry *req) {
+  const struct req_compute *c = &req->compute;
+  uint64_t n = matrix_size;
+  if (!MemValid(req, c->off_ina, n * n) || !MemValid(req, c->off_inb, n * n) ||
+      !MemValid(req, c->off_out, n * n))
+    return;
+
+  const uint8_t *a = mem + c->off_ina;
+  const uint8_t *b = mem + c->off_inb;
+  uint8_t *out = mem + c->off_out;
+  for (uint64_t i = 0; i < n; i++) {
+    for (uint64_t j = 0; j < n; j++) {
+      uint8_t sum = c->rst_out ? 0 : out[i * n + j];
+      for (uint64_t k = 0; k < n; k++)
+        sum += a[i * n + k] * b[k * n + j];
+      out[i * n + j] = sum;
+    }
+  }
+}
+
+/* start executing request `idx` on its unit */
+static void StartRequest(uint64_t idx) {
+  const union req_entry *req = &req_cache[idx % REQ_CACHE];
+  const struct req_dma *d = &req->dma;
+  enum unit u = ReqUnit(req);
+  uint64_t opaque = DMA_DATA | (idx % REQ_CACHE) << DMA_IDX_SHIFT;
+
+  req_states[idx % REQ_CACHE] = RS_RUNNING;
+  switch (req->hdr.type) {
+    case REQ_TYPE_DMAREAD:
+      dprintf("request %u: dma read 0x%lx -> 0x%lx (%lu)\n", d->hdr.req_id,
+              d->addr, d->mem_off, d->len);
+      if (!d->len || !MemValid(req, d->mem_off, d->len))
+        break;
+      unit_busy[u] = true;
+      IssueDMARead(mem + d->mem_off, d->addr, d->len, opaque);
+      return;
+
+    case REQ_TYPE_DMAWRITE:
+      dprintf("request %u: dma write 0x%lx -> 0x%lx (%lu)\n", d->hdr.req_id,
+              d->mem_off, d->addr, d->len);
+      if (!d->len || !MemValid(req, d->mem_off, d->len))
+        break;
+      unit_busy[u] = true;
+      IssueDMAWrite(d->addr, mem + d->mem_off, d->len, opaque);
+      return;
+
+    case REQ_TYPE_COMPUTE:
+      dprintf("request %u: compute\n", req->hdr.req_id);
+      unit_busy[u] = true;
+      compute_req = idx;
+      compute_done = main_time + op_latency;
+      return;
+
+    default:
+      fprintf(stderr, "warning: request %u has invalid type %u\n",
+              req->hdr.req_id, req->hdr.type);
+  }
+  // nothing to wait for
+  req_states[idx % REQ_CACHE] = RS_DONE;
+}
+
+/* Retire completed requests at the head in order, and send responses if
+   requested. Stops early if out of response buffers. */
+static void RetireRequests(void) {
+  while (cache_head != cache_tail &&
+         req_states[cache_head % REQ_CACHE] == RS_DONE) {
+    const union req_entry *req = &req_cache[cache_head % REQ_CACHE];
+    if ((req->hdr.flags & REQ_FLAG_NOTIFY) && !res_len) {
+      fprintf(stderr, "warning: request %u wants a response, but there is no "
+                      "response queue\n", req->hdr.req_id);
+    } else if (req->hdr.flags & REQ_FLAG_NOTIFY) {
+      if (res_pending == RES_BUFS)
+        return;
+
+      struct res_entry *res = &res_bufs[res_issued++ % RES_BUFS];
+      memset(res, 0, sizeof(*res));
+      res->req_id = req->hdr.req_id;
+      res->type = req->hdr.type;
+      dprintf("request %u: response at %lu\n", res->req_id, res_tail);
+      IssueDMAWrite(res_base + res_tail * sizeof(*res), res,
+                    sizeof(*res), DMA_RESPONSE);
+      res_pending++;
+      res_tail = (res_tail + 1) % res_len;
+    }
+    req_states[cache_head % REQ_CACHE] = RS_WAITING;
+    cache_head++;
+  }
+}
+
+static void SendInterrupt(void) {
+  dprintf("interrupt for %lu responses\n", irq_pending);
+  irq_pending = 0;
+  if (IssueMSI(0))
+    dprintf("MSI disabled, interrupt dropped\n");
+}
+
+/* a response is now visible to the host, interrupt once enough are pending
+   (or after the delay, see PollEvent) */
+static void ResponseWritten(void) {
+  if (!irq_coal_count)
+    return;
+  if (!irq_pending++)
+    irq_deadline = main_time + irq_coal_delay * 1000;
+  if (irq_pending >= irq_coal_count)
+    SendInterrupt();
+}
+
+/* advance the state machine as far as possible without waiting */
+static void Step(void) {
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    RetireRequests();
+    FetchRequests();
+
+    uint64_t end = cache_head + window;
+    if (end > cache_tail)
+      end = cache_tail;
+    for (uint64_t i = cache_head; i < end; i++) {
+      const union req_entry *req = &req_cache[i % REQ_CACHE];
+      enum unit u = ReqUnit(req);
+      if (req_states[i % REQ_CACHE] != RS_WAITING ||
+          (u != NUM_UNITS && unit_busy[u]) || !CanStart(i))
+        continue;
+      StartRequest(i);
+      // requests without a DMA or compute complete immediately
+      progress = progress || req_states[i % REQ_CACHE] == RS_DONE;
+    }
+  }
+}
+
+/******************************************************************************/
+/* Register accesses: the layout is in regs.h, below are the read and write
+   operations of each register */
+
+using accelsim::FieldOps;
+using accelsim::NoDev;
+using accelsim::RegOps;
+
+static NoDev nodev;
+
+/* Can the queues be resized? Not while requests are fetched, cached, or
+   responses are being written, since those still refer to the old ring. */
+static bool QueuesIdle(const char *reg, uint64_t val) {
+  if (!val) {
+    fprintf(stderr, "MMIO Write: warning %s must not be 0\n", reg);
+    return false;
+  }
+  if (fetching || cache_head != cache_tail || res_pending) {
+    fprintf(stderr, "MMIO Write: warning %s written with requests "
+                    "outstanding, ignored\n", reg);
+    return false;
+  }
+  return true;
+}
+
+/* writing a queue length resets the queue to empty */
+static void WriteReqLen(NoDev &, unsigned, uint64_t val) {
+  if (!QueuesIdle("request queue length", val))
+    return;
+  req_len = val;
+  req_head = req_tail = 0;
+}
+
+static void WriteReqTail(NoDev &, unsigned, uint64_t val) {
+  if (val >= req_len) {
+    fprintf(stderr, "MMIO Write: warning request tail %lu out of range\n",
+            val);
+    return;
+  }
+  req_tail = val;
+  Step();
+}
+
+static void WriteResLen(NoDev &, unsigned, uint64_t val) {
+  if (!QueuesIdle("response queue length", val))
+    return;
+  res_len = val;
+  res_tail = 0;
+}
+
+static void WriteIrqCoalCount(NoDev &, unsigned, uint64_t val) {
+  irq_coal_count = val;
+  if (!irq_coal_count)
+    irq_pending = 0;
+  else if (irq_pending >= irq_coal_count)
+    SendInterrupt();
+}
+
+#define FIELD(x) FieldOps<NoDev, &x>::Read, FieldOps<NoDev, &x>::Write
+
+static constexpr RegOps<NoDev> kRegOps[] = {
+  {"SIZE", FieldOps<NoDev, &matrix_size>::Read, nullptr},
+  {"MEM_SIZE", FieldOps<NoDev, &mem_size>::Read, nullptr},
+  {"REQ_BASE", FIELD(req_base)},
+  {"REQ_LEN", FieldOps<NoDev, &req_len>::Read, WriteReqLen},
+  {"REQ_TAIL", FieldOps<NoDev, &req_tail>::Read, WriteReqTail},
+  {"REQ_HEAD", FieldOps<NoDev, &req_head>::Read, nullptr},
+  {"RES_BASE", FIELD(res_base)},
+  {"RES_LEN", FieldOps<NoDev, &res_len>::Read, WriteResLen},
+  {"IRQ_COAL_COUNT", FieldOps<NoDev, &irq_coal_count>::Read,
+   WriteIrqCoalCount},
+  {"IRQ_COAL_DELAY", FIELD(irq_coal_delay)},
+};
+
+#undef FIELD
+
+static constexpr auto kRegs = accelsim::MakeRegMap<kRegInfo, kRegOps>();
+
+void MMIORead(volatile struct SimbricksProtoPcieH2DRead *read) {
+  dprintf("MMIO Read: BAR %d offset 0x%lx len %d\n", read->bar,
+    read->offset, read->len);
+
+  // praepare read completion
+  volatile union SimbricksProtoPcieD2H *msg = AllocPcieOut();
+  volatile struct SimbricksProtoPcieD2HReadcomp *rc = &msg->readcomp;
+  rc->req_id = read->req_id; // set req id so host can match resp to a req
+
+  // zero it out in case of bad register
+  memset((void *) rc->data, 0, read->len);
+
+  uint64_t val = 0;
+  if (kRegs.Read(nodev, read->offset, read->len, val)) {
+    dprintf("MMIO Read Result: %lx\n", val);
+    memcpy((void *) rc->data, &val, read->len);
+  } else {
+    fprintf(stderr, "MMIO Read: warning read from invalid register 0x%lx\n",
+      read->offset);
+  }
+
+  // send response
+  SendPcieOut(msg, SIMBRICKS_PROTO_PCIE_D2H_MSG_READCOMP);
+}
+
+void MMIOWrite(volatile struct SimbricksProtoPcieH2DWrite *write) {
+  uint64_t val = 0;
+  if (write->len <= 8)
+    memcpy(&val, (const void *) write->data, write->len);
+  dprintf("MMIO Write: BAR %d offset 0x%lx len %d val %lx\n", write->bar,
+    write->offset, write->len, val);
+  if (!kRegs.Write(nodev, write->offset, write->len, val))
+    fprintf(stderr, "MMIO Write: warning write to invalid register 0x%lx\n",
+      write->offset);
+}
+
+void PollEvent(void) {
+  if (unit_busy[UNIT_COMPUTE] && main_time >= compute_done) {
+    Compute(&req_cache[compute_req % REQ_CACHE]);
+    unit_busy[UNIT_COMPUTE] = false;
+    req_states[compute_req % REQ_CACHE] = RS_DONE;
+    Step();
+  }
+  if (irq_pending && main_time >= irq_deadline)
+    SendInterrupt();
+}
+
+uint64_t NextEvent(void) {
+  uint64_t next = UINT64_MAX;
+  if (unit_busy[UNIT_COMPUTE])
+    next = compute_done;
+  if (irq_pending && irq_deadline < next)
+    next = irq_deadline;
+  return next;
+}
+
+void DMACompleteEvent(uint64_t opaque) {
+  uint64_t idx = opaque >> DMA_IDX_SHIFT;
+  switch (opaque & DMA_TYPE_MASK) {
+    case DMA_FETCH:
+      dprintf("fetched %lu requests\n", fetch_num);
+      cache_tail += fetch_num;
+      req_head = (req_head + fetch_num) % req_len;
+      fetching = false;
+      break;
+
+    case DMA_DATA:
+      assert(req_states[idx] == RS_RUNNING);
+      unit_busy[ReqUnit(&req_cache[idx])] = false;
+      req_states[idx] = RS_DONE;
+      break;
+
+    case DMA_RESPONSE:
+      assert(res_pending > 0);
+      res_pending--;
+      ResponseWritten();
+      break;
+  }
+  Step();
+}
@@ -74,9 +74,40 @@ void IssueDMARead(void *dst, uint64_t src_addr, size_t len, uint64_t opaque);
 void IssueDMAWrite(uint64_t dst_addr, const void *src, size_t len,
     uint64_t opaque);
 
+/** Number of DMA issue queues. `IssueDMARead` and `IssueDMAWrite` use
+ *  DMA_QUEUE_READ and DMA_QUEUE_WRITE respectively. */
+#define DMA_NUM_QUEUES 4
+#define DMA_QUEUE_READ 0
+#define DMA_QUEUE_WRITE 1
+
+/** Same as `IssueDMARead`, but queue the operation on DMA queue `queue`. */
+void IssueDMAReadQ(unsigned queue, void *dst, uint64_t src_addr, size_t len,
+    uint64_t opaque);
+
+/** Same as `IssueDMAWrite`, but queue the operation on DMA queue `queue`. */
+void IssueDMAWriteQ(unsigned queue, uint64_t dst_addr, const void *src,
+    size_t len, uint64_t opaque);
+
+/**
+ * Configure arbitration for a DMA queue. Pending DMA credits go to the
+ * non-empty queues with the highest priority first, queues with the same
+ * priority take turns issuing up to `weight` sub-operations each (weighted
+ * round-robin). All queues start with priority 0 and weight 1.
+ * @param queue    Queue number (< DMA_NUM_QUEUES).
+ * @param prio     Priority, higher is served first.
+ * @param weight   Round-robin weight, must be at least 1.
+ */
+void DMAQueueConfig(unsigned queue, unsigned prio, unsigned weight);
+
+/**
+ * Send MSI interrupt `vector` to the host. Returns != 0 (and drops the
+ * interrupt) if the host has not enabled MSI for the device.
+ */
+int IssueMSI(uint16_t vector);
+
 
 /******************************************************************************/
-/* Functions you will implement in sim.c */
+/* Functions you will implement in sim.cc */
 
 /**
  * Called once during initialization. Use this to initialize your internal
@@ -108,4 +139,10 @@ uint64_t NextEvent(void);
  * on DMA issue. */
 void DMACompleteEvent(uint64_t opaque);
 
+/**
+ * Called for simulator options not handled by the framework (opt is
+ * "NAME=VAL" for --NAME=VAL). Returns 0 if the option is valid.
+*/
+int ParseOption(const char *opt);
+
 #endif  // ndef ACCEL_SIM_SIM_H_
\ No newline at end of file
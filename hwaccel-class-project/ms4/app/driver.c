@@ -23,27 +23,86 @@
  */
 
 #include <assert.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <vfio-pci.h>
 #include <dma-alloc.h>
+#include <tile-plan.h>
+#include <utils.h>
 
 #include "../common/reg_defs.h"
 #include "driver.h"
 
+//#define DEBUG
+#ifdef DEBUG
+#define dprintf(x...) fprintf(stderr, "DRV: "x)
+#else
+#define dprintf(...) do { } while (0)
+#endif
+
 /** Use this macro to safely access a register at a specific offset */
 #define ACCESS_REG(r) (*(volatile uint64_t *) ((uintptr_t) regs + r))
 
 static void *regs;
 
-/* DMA memory for matrices */
+/* DMA memory for matrices: A, B, and output in block format */
 static size_t dma_mem_size = 16 * 1024 * 1024;
 static uint8_t *dma_mem;
 static uintptr_t dma_mem_phys;
 
+/* request and response queues */
+#define REQ_QUEUE_LEN 256
+#define RES_QUEUE_LEN 16
+/* max requests enqueued before we write the tail register */
+#define REQ_DOORBELL_BATCH 32
+static volatile union req_entry *req_queue;
+static uintptr_t req_queue_phys;
+static volatile struct res_entry *res_queue;
+static uintptr_t res_queue_phys;
+/* next request queue entry to write */
+static uint64_t req_tail;
+/* device fetch position as of the last check, entries from here to req_tail
+   are still in use */
+static uint64_t req_head;
+/* requests enqueued since the last tail register write */
+static uint64_t req_unsignalled;
+/* next response queue entry to read */
+static uint64_t res_head;
+/* id of the last request with a response we have seen */
+static uint32_t res_done;
+/* requests with REQ_FLAG_NOTIFY submitted but without a response yet, at
+   most RES_QUEUE_LEN so the device never overwrites unread responses */
+static unsigned res_outstanding;
+static uint32_t next_req_id = 1;
+
+/* MSI eventfd, if the MATMUL_IRQ environment variable is set to
+   "COUNT[,DELAY_NS]" (see REG_IRQ_COAL_*). Waiting for responses then sleeps
+   until the next interrupt instead of spinning on the response queue. */
+static int irq_fd = -1;
+
+/* Wait for each request to complete before submitting the next one, i.e. use
+   the queues like the synchronous register interface from ms3. Set with the
+   MATMUL_SYNC environment variable, for comparison. */
+static bool sync_reqs;
+
+static size_t matrix_size;
+static size_t mem_size;
+static struct devmem devmem;
+/* max. output block rows per group in the block schedule, 0 lets the planner
+   choose. Set with the MATMUL_PLAN_ROWS environment variable, for
+   comparison. */
+static size_t plan_rows;
+/* device time of a block multiplication and transfer for the planner,
+   measured in accelerator_init (see measure_cost) */
+static struct tile_cost plan_cost;
+
+static void measure_cost(struct tile_cost *cost, size_t tile);
+
 int accelerator_init(bool dma) {
   struct vfio_dev dev;
   size_t reg_len;
@@ -68,24 +127,320 @@ int accelerator_init(bool dma) {
     return -1;
   }
 
-  // TODO: Probably want to allocate memory for the queues here too
+  if (!(req_queue = dma_alloc_alloc(REQ_QUEUE_LEN * sizeof(*req_queue),
+                                    &req_queue_phys)) ||
+      !(res_queue = dma_alloc_alloc(RES_QUEUE_LEN * sizeof(*res_queue),
+                                    &res_queue_phys))) {
+    fprintf(stderr, "Allocating queue memory failed\n");
+    return -1;
+  }
+  memset((void *) req_queue, 0, REQ_QUEUE_LEN * sizeof(*req_queue));
+  memset((void *) res_queue, 0, RES_QUEUE_LEN * sizeof(*res_queue));
 
   if (vfio_busmaster_enable(&dev)) {
     fprintf(stderr, "Enabling busmastering failed\n");
     return -1;
   }
 
-  // FILL ME IN
+  matrix_size = ACCESS_REG(REG_SIZE);
+  mem_size = ACCESS_REG(REG_MEM_SIZE);
+  devmem_init(&devmem, mem_size);
+
+  ACCESS_REG(REG_REQ_BASE) = req_queue_phys;
+  ACCESS_REG(REG_REQ_LEN) = REQ_QUEUE_LEN;
+  ACCESS_REG(REG_RES_BASE) = res_queue_phys;
+  ACCESS_REG(REG_RES_LEN) = RES_QUEUE_LEN;
 
+  sync_reqs = getenv("MATMUL_SYNC") != NULL;
+  if (getenv("MATMUL_PLAN_ROWS"))
+    plan_rows = strtoull(getenv("MATMUL_PLAN_ROWS"), NULL, 0);
+
+  const char *irq = getenv("MATMUL_IRQ");
+  if (irq) {
+    char *end;
+    uint64_t count = strtoull(irq, &end, 0);
+    uint64_t delay = *end == ',' ? strtoull(end + 1, NULL, 0) : 0;
+    if (!count) {
+      fprintf(stderr, "MATMUL_IRQ must be COUNT[,DELAY_NS] with COUNT > 0\n");
+      return -1;
+    }
+    if (vfio_irq_eventfd(&dev, VFIO_PCI_MSI_IRQ_INDEX, 1, &irq_fd)) {
+      fprintf(stderr, "Setting up MSI failed\n");
+      return -1;
+    }
+    ACCESS_REG(REG_IRQ_COAL_DELAY) = delay;
+    ACCESS_REG(REG_IRQ_COAL_COUNT) = count;
+  }
+
+  if (mem_size < matrix_size * matrix_size) {
+    fprintf(stderr, "Accelerator memory smaller than one block\n");
+    return -1;
+  }
+  measure_cost(&plan_cost, matrix_size * matrix_size);
   return 0;
 }
 
 int accelerator_matrix_size(void) {
-  // FILL ME IN
-  return 42;
+  return matrix_size;
+}
+
+/** Tell the device about the requests enqueued so far. */
+static inline void req_signal(void) {
+  if (!req_unsignalled)
+    return;
+  ACCESS_REG(REG_REQ_TAIL) = req_tail;
+  req_unsignalled = 0;
+}
+
+/** Consume the responses written so far, returns how many there were. */
+static unsigned res_poll(void) {
+  unsigned n = 0;
+  uint32_t id;
+  while ((id = res_queue[res_head].req_id)) {
+    dprintf("request %u completed\n", id);
+    res_done = id;
+    res_queue[res_head].req_id = 0;
+    res_head = (res_head + 1) % RES_QUEUE_LEN;
+    res_outstanding--;
+    n++;
+  }
+  return n;
+}
+
+/** Wait for at least one more response. With interrupts enabled this sleeps
+ * on the eventfd between checks. An interrupt that arrived before we check
+ * leaves the eventfd readable, so none are lost. */
+static void res_wait_any(void) {
+  uint64_t cnt;
+  req_signal();
+  while (!res_poll()) {
+    if (irq_fd < 0)
+      continue;
+    struct pollfd pfd = { .fd = irq_fd, .events = POLLIN };
+    if (poll(&pfd, 1, -1) > 0 && read(irq_fd, &cnt, sizeof(cnt)) < 0) {
+      perror("res_wait_any: read eventfd failed");
+      abort();
+    }
+  }
+}
+
+/** Has request `id` (or a later one) completed? */
+static inline bool req_done(uint32_t id) {
+  return (int32_t) (res_done - id) >= 0;
+}
+
+/** Wait for the response to request `id`. Only requests with REQ_FLAG_NOTIFY
+ * get a response, and the device sends it once the request and all requests
+ * before it are complete. */
+static void req_wait(uint32_t id) {
+  res_poll();
+  while (!req_done(id))
+    res_wait_any();
+}
+
+/** Get the next free request queue entry and fill in its header. Only blocks
+ * if the request queue is full, or for a request with a response if too many
+ * responses are outstanding. */
+static volatile union req_entry *req_alloc(uint16_t type, uint16_t flags) {
+  if (sync_reqs)
+    flags |= REQ_FLAG_NOTIFY;
+  res_poll();
+  while ((flags & REQ_FLAG_NOTIFY) && res_outstanding >= RES_QUEUE_LEN)
+    res_wait_any();
+  while ((req_tail + 1) % REQ_QUEUE_LEN == req_head) {
+    // rather than spinning on the head register, sleep until the device
+    // completes something
+    if (irq_fd >= 0 && res_outstanding)
+      res_wait_any();
+    else
+      req_signal();
+    req_head = ACCESS_REG(REG_REQ_HEAD);
+  }
+
+  volatile union req_entry *req = &req_queue[req_tail];
+  req->hdr.req_id = next_req_id;
+  req->hdr.flags = flags;
+  req->hdr.type = type;
+  if (flags & REQ_FLAG_NOTIFY)
+    res_outstanding++;
+  return req;
+}
+
+/** Enqueue the request filled in after req_alloc, returns its id. */
+static uint32_t req_submit(void) {
+  uint32_t id = next_req_id++;
+  if (!next_req_id)
+    next_req_id = 1;
+
+  req_tail = (req_tail + 1) % REQ_QUEUE_LEN;
+  if (++req_unsignalled >= REQ_DOORBELL_BATCH)
+    req_signal();
+  if (sync_reqs)
+    req_wait(id);
+  return id;
+}
+
+/** Enqueue a DMA between host physical address `addr` and accelerator memory
+ * at `mem_off`. */
+static uint32_t req_dma(uint16_t type, uintptr_t addr, uint64_t mem_off,
+                        size_t len, uint16_t flags) {
+  volatile union req_entry *req = req_alloc(type, flags);
+  req->dma.addr = addr;
+  req->dma.mem_off = mem_off;
+  req->dma.len = len;
+  return req_submit();
+}
+
+/** Enqueue a block multiplication that overwrites (`rst_out`) or adds onto
+ * the output block. */
+static uint32_t req_compute(uint64_t off_ina, uint64_t off_inb,
+                            uint64_t off_out, bool rst_out, uint16_t flags) {
+  volatile union req_entry *req = req_alloc(REQ_TYPE_COMPUTE, flags);
+  req->compute.off_ina = off_ina;
+  req->compute.off_inb = off_inb;
+  req->compute.off_out = off_out;
+  req->compute.rst_out = rst_out;
+  return req_submit();
+}
+
+/** Copy an n x n matrix into `n_b` x `n_b` contiguous blocks of size `block`,
+ * padded with zeros. */
+static void to_blocks(uint8_t *dst, const uint8_t *src, size_t n, size_t n_b,
+                      size_t block) {
+  size_t bi, bj, r;
+  memset(dst, 0, n_b * n_b * block * block);
+  for (bi = 0; bi < n_b; bi++) {
+    for (bj = 0; bj < n_b; bj++) {
+      uint8_t *blk = dst + (bi * n_b + bj) * block * block;
+      size_t rows = n - bi * block < block ? n - bi * block : block;
+      size_t cols = n - bj * block < block ? n - bj * block : block;
+      for (r = 0; r < rows; r++)
+        memcpy(blk + r * block, src + (bi * block + r) * n + bj * block, cols);
+    }
+  }
+}
+
+/** Inverse of to_blocks for block `idx` (row-major), drops the padding. */
+static void from_block(uint8_t *dst, const uint8_t *src, size_t n, size_t n_b,
+                       size_t block, size_t idx) {
+  size_t bi = idx / n_b, bj = idx % n_b, r;
+  const uint8_t *blk = src + idx * block * block;
+  size_t rows = n - bi * block < block ? n - bi * block : block;
+  size_t cols = n - bj * block < block ? n - bj * block : block;
+  for (r = 0; r < rows; r++)
+    memcpy(dst + (bi * block + r) * n + bj * block, blk + r * block, cols);
+}
+
+/** Cycles from submitting a request with a response until it completes. */
+static uint64_t req_time(uint16_t type, size_t len) {
+  uint64_t start = rdtsc();
+  uint32_t id = type == REQ_TYPE_COMPUTE ?
+    req_compute(0, 0, 0, true, REQ_FLAG_NOTIFY) :
+    req_dma(type, dma_mem_phys, 0, len, REQ_FLAG_NOTIFY);
+  req_wait(id);
+  return rdtsc() - start;
+}
+
+/** Measure the device time of one block multiplication and one block load for
+ * the planner. A zero-length DMA completes without any work on the device,
+ * so its time is the queue round trip, which is subtracted from both. */
+static void measure_cost(struct tile_cost *cost, size_t tile) {
+  uint64_t base = req_time(REQ_TYPE_DMAREAD, 0);
+  uint64_t load = req_time(REQ_TYPE_DMAREAD, tile);
+  uint64_t compute = req_time(REQ_TYPE_COMPUTE, 0);
+  cost->transfer = load > base ? load - base : 0;
+  cost->compute = compute > base ? compute - base : 0;
+  dprintf("cost: %lu cycles per block load, %lu per multiplication\n",
+          cost->transfer, cost->compute);
 }
 
 void matmult_accel(const uint8_t * restrict A, const uint8_t * restrict B,
                    uint8_t * restrict out, size_t n) {
-  // FILL ME IN
+  size_t block = matrix_size;
+  size_t tile = block * block;
+  size_t n_b = (n + block - 1) / block;
+  size_t blocks_size = n_b * n_b * tile;
+  size_t i, j, k, r, g;
+
+  if (3 * blocks_size > dma_mem_size) {
+    fprintf(stderr, "matmult_accel: matrix too large for DMA buffer\n");
+    abort();
+  }
+
+  struct tile_mem tmem = { mem_size / tile, SIZE_MAX, SIZE_MAX, SIZE_MAX,
+                           false };
+  struct tile_plan plan;
+  if (tile_plan(&plan, n_b, &tmem, &plan_cost, plan_rows)) {
+    fprintf(stderr, "matmult_accel: accelerator memory too small\n");
+    abort();
+  }
+  dprintf("plan: %zu rows, A %s, slots %zu/%zu/%zu, %lu transfers\n",
+          plan.rows, plan.a_resident ? "resident" : "streamed", plan.a_slots,
+          plan.b_slots, plan.out_slots, plan.transfers);
+
+  uint8_t *buf_a = dma_mem;
+  uint8_t *buf_b = buf_a + blocks_size;
+  uint8_t *buf_out = buf_b + blocks_size;
+  uintptr_t phys_a = dma_mem_phys;
+  uintptr_t phys_b = phys_a + blocks_size;
+  uintptr_t phys_out = phys_b + blocks_size;
+  to_blocks(buf_a, A, n, n_b, block);
+  to_blocks(buf_b, B, n, n_b, block);
+
+  /* Accelerator memory is split into the slots of the plan (see tile_plan).
+     Streamed A blocks and B blocks alternate between their slots, and
+     consecutive groups of output blocks between output slot sets, so the
+     device can load the next block and drain the previous outputs while it
+     computes. */
+  uint64_t off_a, off_b, off_out;
+  devmem_reset(&devmem);
+  if (devmem_alloc(&devmem, plan.a_slots * tile, &off_a) ||
+      devmem_alloc(&devmem, plan.b_slots * tile, &off_b) ||
+      devmem_alloc(&devmem, plan.out_slots * tile, &off_out)) {
+    fprintf(stderr, "matmult_accel: planned slots do not fit\n");
+    abort();
+  }
+  size_t out_sets = plan.out_slots / plan.rows;
+
+  /* The whole sequence is enqueued up front, the device works through it
+     while we are still adding requests. Only output block writes ask for a
+     response, and we copy each block out as soon as it is written. Blocks
+     complete in the order of `outs`. */
+  struct { uint32_t id; size_t idx; } *outs =
+      malloc(n_b * n_b * sizeof(*outs));
+  size_t op = 0, b_op = 0, out_op = 0, n_outs = 0, copied = 0;
+  assert(outs);
+  for (g = 0; g < n_b; g += plan.rows) {
+    size_t rows = n_b - g < plan.rows ? n_b - g : plan.rows;
+    for (j = 0; j < n_b; j++) {
+      uint64_t out_set = off_out + (out_op++ % out_sets) * plan.rows * tile;
+      for (k = 0; k < n_b; k++, b_op++) {
+        uint64_t b_slot = off_b + (b_op % plan.b_slots) * tile;
+        req_dma(REQ_TYPE_DMAREAD, phys_b + (k * n_b + j) * tile, b_slot, tile,
+                0);
+        for (r = 0; r < rows; r++, op++) {
+          i = g + r;
+          uint64_t a_slot = off_a + (plan.a_resident ? r * n_b + k :
+                                     op % plan.a_slots) * tile;
+          if (!plan.a_resident || j == 0)
+            req_dma(REQ_TYPE_DMAREAD, phys_a + (i * n_b + k) * tile, a_slot,
+                    tile, 0);
+          req_compute(a_slot, b_slot, out_set + r * tile, k == 0, 0);
+        }
+      }
+      for (r = 0; r < rows; r++, n_outs++) {
+        outs[n_outs].idx = (g + r) * n_b + j;
+        outs[n_outs].id = req_dma(REQ_TYPE_DMAWRITE,
+                                  phys_out + outs[n_outs].idx * tile,
+                                  out_set + r * tile, tile, REQ_FLAG_NOTIFY);
+      }
+      for (; copied < n_outs && req_done(outs[copied].id); copied++)
+        from_block(out, buf_out, n, n_b, block, outs[copied].idx);
+    }
+  }
+  for (; copied < n_outs; copied++) {
+    req_wait(outs[copied].id);
+    from_block(out, buf_out, n, n_b, block, outs[copied].idx);
+  }
+  free(outs);
 }
@@ -26,7 +26,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
+#include <matmul-cpu.h>
 #include <utils.h>
 
 #include "driver.h"
@@ -43,6 +45,14 @@ uint8_t *zero_matrix_alloc(size_t m, size_t n) {
   return calloc(m * n, sizeof(uint8_t));
 }
 
+/* CPU time used by this process in ns, excludes time blocked waiting for
+   interrupts */
+static uint64_t cpu_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 /* software implementaiton for reference */
 void matmult(const uint8_t * restrict inA, const uint8_t * restrict inB,
     uint8_t * restrict out, size_t n) {
@@ -79,6 +89,30 @@ void test_functionality(size_t n)
     printf("STATUS: Failure Matrices do not match\n");
 }
 
+/* Time the optimized CPU multiplication (matmult_cpu) on the same inputs, the
+   baseline the accelerator has to beat. It takes a while in timing
+   simulation, MATMUL_BASELINE=0 skips it. */
+void measure_baseline(const uint8_t *A, const uint8_t *B, uint8_t *out,
+                      size_t n, size_t iterations, uint64_t accel_cycles)
+{
+  const char *env = getenv("MATMUL_BASELINE");
+  if (env && !atoi(env))
+    return;
+
+  size_t i;
+  uint64_t total_cycles = 0;
+  for (i = 0; i < iterations; i++) {
+    uint64_t start = rdtsc();
+    matmult_cpu(A, B, out, n, 0);
+    total_cycles += rdtsc() - start;
+  }
+
+  uint64_t cycles = total_cycles / iterations;
+  printf("CPU baseline cycles per operation: %ld\n", cycles);
+  if (accel_cycles)
+    printf("Speedup over CPU baseline: %.2f\n", (double) cycles / accel_cycles);
+}
+
 void measure(size_t n, size_t iterations)
 {
   uint8_t *A = rand_matrix_alloc(n, n);
@@ -87,13 +121,18 @@ void measure(size_t n, size_t iterations)
 
   size_t i;
   uint64_t total_cycles = 0;
+  uint64_t total_cpu = 0;
   for (i = 0; i < iterations; i++) {
+    uint64_t start_cpu = cpu_time();
     uint64_t start = rdtsc();
     matmult_accel(A, B, out, n);
     total_cycles += rdtsc() - start;
+    total_cpu += cpu_time() - start_cpu;
   }
 
   printf("Cycles per operation: %ld\n", total_cycles / iterations);
+  printf("CPU ns per operation: %ld\n", total_cpu / iterations);
+  measure_baseline(A, B, out, n, iterations, total_cycles / iterations);
 }
 
 int main(int argc, char *argv[])
@@ -10,22 +10,9 @@
 /**************************************/
 /* Register definitions (suggestions)*/
 
-/** Size register: contains supported matrix size (width/height). read-only */
-#define REG_SIZE 0x00
-/** Register containing size of the on-accelerator memory. read-only */
-#define REG_MEM_SIZE 0x08
-
-/** Physical start address of the request queue in host memory. R-W */
-#define REG_REQ_BASE 0x10
-/** Length of the request queue (# of entries). R-W */
-#define REG_REQ_LEN  0x18
-/** Index of the next queue entry SW will write to. R-W */
-#define REG_REQ_TAIL 0x20
-
-/** Physical start address of the response queue in host memory. R-W */
-#define REG_RES_BASE 0x30
-/** Length of the request queue (# of entries). R-W */
-#define REG_RES_LEN  0x38
+/* Register offsets (REG_*) are generated from accel-sim/regs.h, edit them
+   there and run `make common/reg_map.h`. */
+#include "reg_map.h"
 
 
 /******************************************/
@@ -53,3 +53,23 @@ def load_testfile(fn):
     fail('Loading simulation JSON output failed')
 
   return data
+
+
+# cycles per operation the app printed in experiment `name`, with `cpu_ns` a
+# tuple that also has the CPU ns per operation
+def cycles_per_op(name, cpu_ns=False):
+  data = load_testfile(f'out/{name}-1.json')
+  try:
+    out = data['sims']['host.host']['stdout']
+    cycles = find_line(out, '^Cycles per operation: ([0-9]*)')
+    if not cycles:
+      fail('Could not find "Cycles per operation:" output')
+    if not cpu_ns:
+      return int(cycles.group(1))
+    cpu = find_line(out, '^CPU ns per operation: ([0-9]*)')
+    if not cpu:
+      fail('Could not find "CPU ns per operation:" output')
+    return (int(cycles.group(1)), int(cpu.group(1)))
+  except Exception:
+    exception_thrown()
+    fail('Parsing simulation output failed')
@@ -26,18 +26,32 @@ class HwAccelNode(node.NodeConfig):
 
 # Actual application to run. Includes the command to run, but also makes sure
 # the compiled binary gets copied into the disk image of the simulated machine.
+# With sync=True the driver waits for each request before submitting the next
+# one, like the register interface in ms3. With irq='COUNT,DELAY_NS' the
+# driver sleeps on MSI interrupts with those coalescing settings instead of
+# polling for responses. plan_rows limits how many output block rows the
+# driver's block schedule computes together.
 class MatMulApp(node.AppConfig):
-    def __init__(self, n = None, its = None, dma = False):
+    def __init__(self, n = None, its = None, dma = False, sync = False,
+                 irq = None, plan_rows = None):
         super().__init__()
         self.n = n
         self.its = its
         self.dma = dma
+        self.sync = sync
+        self.irq = irq
+        self.plan_rows = plan_rows
 
     def run_cmds(self, node):
+        env = 'MATMUL_SYNC=1 ' if self.sync else ''
+        if self.irq is not None:
+            env += f'MATMUL_IRQ={self.irq} '
+        if self.plan_rows is not None:
+            env += f'MATMUL_PLAN_ROWS={self.plan_rows} '
         if self.its is None:
-          return [f'/tmp/guest/matmul-accel {int(self.dma)} {self.n}']
+          return [f'{env}/tmp/guest/matmul-accel {int(self.dma)} {self.n}']
         else:
-          return [f'/tmp/guest/matmul-accel {int(self.dma)} {self.n} {self.its}']
+          return [f'{env}/tmp/guest/matmul-accel {int(self.dma)} {self.n} {self.its}']
 
     def config_files(self, environment: env.ExpEnv):
         # copy binary into host image during prep
@@ -49,6 +63,16 @@ class MatMulApp(node.AppConfig):
 class HWAccelSim(sim.PCIDevSim):
     sync = True
 
+    # PCIe DMA model parameters, None keeps the simulator default
+    dma_mtu = None        # max payload size per DMA request (bytes, <= 4096)
+    dma_credits = None    # max outstanding DMA requests (<= 256)
+    dma_issue_lat = None  # fixed issue latency per DMA operation (ps)
+    dma_bw = None         # DMA request bandwidth cap (MB/s)
+
+    # requests considered for out-of-order issue, 1 for in-order execution,
+    # None keeps the simulator default
+    window = None
+
     def __init__(self, op_latency, matrix_size, mem_size):
         super().__init__()
         self.op_latency = op_latency
@@ -59,4 +83,15 @@ class HWAccelSim(sim.PCIDevSim):
         cmd = '%s%s %d %d %d %s %s' % \
             (os.getcwd(), '/accel-sim/sim', self.op_latency, self.matrix_size,
              self.mem_size, env.dev_pci_path(self), env.dev_shm_path(self))
-        return cmd
+        if self.window is not None:
+            cmd += f' --window={self.window}'
+        return cmd + self.dma_args()
+
+    def dma_args(self):
+        args = ''
+        for opt, val in [('mtu', self.dma_mtu), ('credits', self.dma_credits),
+                         ('issue-lat', self.dma_issue_lat),
+                         ('bw', self.dma_bw)]:
+            if val is not None:
+                args += f' --dma-{opt}={val}'
+        return args
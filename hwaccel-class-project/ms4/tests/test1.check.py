@@ -17,20 +17,11 @@ except Exception:
 cycle_times = []
 
 for lat in [10000000000, 1000000000, 1000000, 1000]:
-  data = load_testfile(f'out/test1-{lat}-1.json')
-
-  try:
-    out = data['sims']['host.host']['stdout']
-    line = find_line(out, '^Cycles per operation: ([0-9]*)')
-    if not line:
-      fail('Could not find "Cycles per operation:" output')
-
-    cycles = int(line.group(1))
-    cycle_times.append((lat, cycles))
-    print(f'Delay {lat} -> {cycles} Cycles/op')
-  except Exception:
-    exception_thrown()
-    fail('Parsing simulation output failed')
+  cycles = cycles_per_op(f'test1-{lat}')
+  sync_cycles = cycles_per_op(f'test1-sync-{lat}')
+  cycle_times.append((lat, cycles))
+  print(f'Delay {lat} -> {cycles} Cycles/op, {sync_cycles} synchronous '
+        f'({sync_cycles / cycles:.2f}x)')
 
 perf_targets = {
   10000000000: (655449609, '0%'),
@@ -1,8 +1,11 @@
 # TEST 1: Performance test for the hardware accelerated systems with reduced
 # output copies when multiplying larger matrices than supported with the
 # hardware accelerator with different configured latencies for the accelerator
-# to complete the operations. Expect this to take about 5 minutes.
+# to complete the operations. Each latency also runs with synchronous requests
+# (test1-sync-*), one at a time like the register interface in ms3, for
+# comparison. Expect this to take about 10 minutes.
 
+import itertools
 import sys; sys.path.append('./tests/') # add tests dir to module search path
 import simbricks.orchestration.experiments as exp
 import simbricks.orchestration.simulators as sim
@@ -13,12 +16,13 @@ experiments = []
 
 # Run test with multiple different operation latencies for the accelerator
 #           10ms         1ms         1us      1ns
-for lat in [10000000000, 1000000000, 1000000, 1000]:
-  e = exp.Experiment(f'test1-{lat}')
+for (lat, sync) in itertools.product([10000000000, 1000000000, 1000000, 1000],
+                                     [False, True]):
+  e = exp.Experiment(f'test1-sync-{lat}' if sync else f'test1-{lat}')
   e.checkpoint = True
 
   server_config = HwAccelNode()
-  server_config.app = MatMulApp(512, 10, dma=True)
+  server_config.app = MatMulApp(512, 10, dma=True, sync=sync)
 
   server = sim.Gem5Host(server_config)
   server.name = 'host'
@@ -0,0 +1,13 @@
+from check_common import *
+
+test_name('test2')
+
+for lat in [1000000000, 1000000, 1000]:
+  inorder = cycles_per_op(f'test2-{lat}-inorder')
+  ooo = cycles_per_op(f'test2-{lat}-ooo')
+  print(f'Delay {lat} -> {inorder} Cycles/op in order, {ooo} out of order '
+        f'({inorder / ooo:.2f}x)')
+  if ooo > inorder:
+    fail(f'For {lat} out-of-order execution is slower than in order')
+
+success()
@@ -0,0 +1,41 @@
+# TEST 2: Pipelining speedup from out-of-order execution in the accelerator.
+# Runs the same multiplication with requests executed strictly in order
+# (window 1) and out of order (default window), for different operation
+# latencies. The accelerator memory fits a row of A blocks plus two B and two
+# output blocks, so the driver double buffers B and output blocks. Expect this
+# to take about 5 minutes.
+
+import itertools
+import sys; sys.path.append('./tests/') # add tests dir to module search path
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+
+from hwaccel_common import *
+
+experiments = []
+
+#                      1ms         1us      1ns
+for (lat, window) in itertools.product([1000000000, 1000000, 1000],
+                                       [1, None]):
+  e = exp.Experiment(f'test2-{lat}-{"inorder" if window else "ooo"}')
+  e.checkpoint = True
+
+  server_config = HwAccelNode()
+  server_config.app = MatMulApp(512, 3, dma=True)
+
+  server = sim.Gem5Host(server_config)
+  server.name = 'host'
+  server.cpu_type = 'TimingSimpleCPU'
+  server.cpu_freq = '1GHz'
+
+  hwaccel = HWAccelSim(lat, 128, 8 * 128 * 128)
+  hwaccel.name = 'accel'
+  hwaccel.sync = True
+  hwaccel.window = window
+  server.add_pcidev(hwaccel)
+
+  e.add_pcidev(hwaccel)
+  e.add_host(server)
+  server.wait = True
+
+  experiments.append(e)
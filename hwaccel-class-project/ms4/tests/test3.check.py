@@ -0,0 +1,16 @@
+from check_common import *
+
+test_name('test3')
+
+(poll_cycles, poll_cpu) = cycles_per_op('test3-poll', cpu_ns=True)
+print(f'Polling -> {poll_cycles} Cycles/op, {poll_cpu} CPU ns/op')
+
+for irq in ['1,0', '4,10000', '16,100000']:
+  (cycles, cpu) = cycles_per_op(f'test3-{irq.replace(",", "-")}',
+                                cpu_ns=True)
+  print(f'MSI {irq} -> {cycles} Cycles/op ({cycles / poll_cycles:.2f}x), '
+        f'{cpu} CPU ns/op ({cpu / poll_cpu:.2f}x)')
+  if cpu >= poll_cpu:
+    fail(f'With interrupts ({irq}) the driver uses as much CPU as polling')
+
+success()
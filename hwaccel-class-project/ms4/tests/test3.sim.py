@@ -0,0 +1,39 @@
+# TEST 3: Interrupt coalescing. Runs the same multiplication with the driver
+# polling the response queue, and sleeping on MSI interrupts with different
+# coalescing settings (max pending responses, max delay in ns). The driver
+# asks for a response for every output block, so more coalescing means fewer
+# interrupts but responses noticed later. Expect this to take about 5 minutes.
+
+import sys; sys.path.append('./tests/') # add tests dir to module search path
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+
+from hwaccel_common import *
+
+# None polls, otherwise MATMUL_IRQ=COUNT,DELAY_NS
+irq_settings = [None, '1,0', '4,10000', '16,100000']
+
+experiments = []
+
+for irq in irq_settings:
+  e = exp.Experiment(f'test3-{irq.replace(",", "-") if irq else "poll"}')
+  e.checkpoint = True
+
+  server_config = HwAccelNode()
+  server_config.app = MatMulApp(512, 3, dma=True, irq=irq)
+
+  server = sim.Gem5Host(server_config)
+  server.name = 'host'
+  server.cpu_type = 'TimingSimpleCPU'
+  server.cpu_freq = '1GHz'
+
+  hwaccel = HWAccelSim(1000000, 128, 8 * 128 * 128)
+  hwaccel.name = 'accel'
+  hwaccel.sync = True
+  server.add_pcidev(hwaccel)
+
+  e.add_pcidev(hwaccel)
+  e.add_host(server)
+  server.wait = True
+
+  experiments.append(e)
@@ -0,0 +1,13 @@
+from check_common import *
+
+test_name('test4')
+
+for n in [512, 1024]:
+  plan = cycles_per_op(f'test4-{n}-plan')
+  rows1 = cycles_per_op(f'test4-{n}-rows1')
+  print(f'Size {n} -> {plan} Cycles/op planned, {rows1} one row at a time '
+        f'({rows1 / plan:.2f}x)')
+  if plan > rows1:
+    fail(f'For {n} the planned schedule is slower than one row at a time')
+
+success()
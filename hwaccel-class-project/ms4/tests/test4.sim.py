@@ -0,0 +1,37 @@
+# TEST 4: Block schedule from the tiling planner. Runs 512 and 1024 matrices
+# with the schedule the planner picks for the accelerator memory (6 blocks),
+# and with the planner limited to one output block row at a time, which loads
+# every B block once per row of A. Uses a delay of 1ns, so the time mostly
+# goes to transfers. Expect this to take about 20 minutes.
+
+import itertools
+import sys; sys.path.append('./tests/') # add tests dir to module search path
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+
+from hwaccel_common import *
+
+experiments = []
+
+for (n, rows) in itertools.product([512, 1024], [None, 1]):
+  e = exp.Experiment(f'test4-{n}-{"rows1" if rows else "plan"}')
+  e.checkpoint = True
+
+  server_config = HwAccelNode()
+  server_config.app = MatMulApp(n, 1, dma=True, plan_rows=rows)
+
+  server = sim.Gem5Host(server_config)
+  server.name = 'host'
+  server.cpu_type = 'TimingSimpleCPU'
+  server.cpu_freq = '1GHz'
+
+  hwaccel = HWAccelSim(1000, 128, 6 * 128 * 128)
+  hwaccel.name = 'accel'
+  hwaccel.sync = True
+  server.add_pcidev(hwaccel)
+
+  e.add_pcidev(hwaccel)
+  e.add_host(server)
+  server.wait = True
+
+  experiments.append(e)
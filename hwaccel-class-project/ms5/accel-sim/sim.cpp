@@ -22,16 +22,20 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <deque>
+#include <vector>
 
 extern "C" {
 #include "../accel-sim/sim.h"
 #include "../common/reg_defs.h"
 }
 
+#include "regs.h"
+
 //#define DEBUG
 #ifdef DEBUG
 #define dprintf(x...) do { \
@@ -42,9 +46,15 @@ extern "C" {
 #define dprintf(...) do { } while (0)
 #endif
 
+// tracing backend, selected with TRACE= in the Makefile
+#if defined(TRACE_FST)
+#include <verilated_fst_c.h>
+typedef VerilatedFstC TraceFile;
 #define TRACE_ENABLED
-#ifdef TRACE_ENABLED
+#elif defined(TRACE_VCD)
 #include <verilated_vcd_c.h>
+typedef VerilatedVcdC TraceFile;
+#define TRACE_ENABLED
 #endif
 #include <Vtop.h>
 
@@ -57,6 +67,12 @@ static uint64_t next_edge = 0;
 static bool next_rising = false;
 static int reset_done = 2;
 
+/* clock gating: while the RTL reports idle and no MMIO or DMA work is
+   pending, we stop clocking it and NextEvent only waits for external events */
+static bool gated = false;
+static uint64_t clock_cycles = 0;
+static uint64_t gated_cycles = 0;
+
 struct MMIOOp {
   uint64_t offset;
   uint64_t val;
@@ -64,79 +80,309 @@ struct MMIOOp {
   uint64_t opaque;
 };
 
+/* A DMA between host memory and the RTL's DMA port. The host side is split
+   into chunks of stream_chunk bytes, each issued as its own host DMA, and
+   beats stream through the port as chunks become available: for reads from
+   the host, a chunk's beats go into the RTL once its completion arrived; for
+   writes to the host, a chunk is written out as soon as all its beats were
+   read out of the RTL. A scatter-gather list (`descs` > 0) holds the place of
+   its descriptors in the FIFO until it has been fetched. */
 struct DMAOp {
   uint8_t *data;
   uint64_t addr;
   uint64_t offset;
   uint64_t len;
-  uint64_t pos;
+  uint64_t pos;       /* bytes transferred through the RTL port */
+  uint64_t issued;    /* bytes issued to the host (writes) */
+  size_t pending;     /* host DMAs outstanding */
+  std::vector<bool> arrived;  /* per chunk: completion arrived (reads) */
   bool write;
+  uint64_t descs;     /* descriptor list: number of descriptors, else 0 */
+  struct DMACtx *ctx; /* context whose FIFO holds the op */
   enum {
     DMAST_READY,
     DMAST_TRANSFERING,
-    DMAST_ISSUED,
   } state;
 };
 
 static std::deque<MMIOOp *> mmio_queue;
 static bool mmio_submitted = false;
 
-static DMAOp *dma_op = nullptr;
-static bool dma_submitted = false;
-static uint64_t dma_len;
-static uint64_t dma_addr;
-static uint64_t dma_off;
+/* DMA registers and descriptor FIFO of one context: writing REG_DMA_CTRL
+   queues a descriptor, descriptors are executed in order, op is the one at
+   the head that is running. Contexts share the RTL's DMA port. */
+struct DMACtx {
+  std::deque<DMAOp *> queue;
+  DMAOp *op = nullptr;
+  uint64_t done = 0;
+  /* descriptors in the FIFO, counting those of lists not yet fetched */
+  uint64_t queued = 0;
+  uint64_t sg_addr = 0;
+  uint64_t len = 0;
+  uint64_t addr = 0;
+  uint64_t off = 0;
+};
+
+static const size_t dma_queue_cap = 16;
+/* register windows (REG_CTX) with DMA registers, independent of how many
+   contexts the RTL has; windows past those have no banks to transfer to */
+static const size_t dma_max_ctx = 16;
+static DMACtx dma_ctx[dma_max_ctx];
+/* context whose op currently owns the DMA port */
+static size_t dma_port = 0;
 
 static Vtop *top;
 
+/* bytes moved through the RTL DMA port per clock cycle */
+static const size_t dma_beat = sizeof(top->dma_w_data);
+/* host DMA granularity for streaming, rounded up to whole beats. 64 matches
+   the usual PCIe read completion boundary. */
+static uint64_t stream_chunk = 64;
+
+/* signal tracing: off unless --trace=FILE is given, and then only dumped
+   between --trace-start and --trace-end */
+static const char *trace_path = nullptr;
+static uint64_t trace_start = 0;
+static uint64_t trace_end = UINT64_MAX;
 #ifdef TRACE_ENABLED
-static VerilatedVcdC *trace;
+static TraceFile *trace = nullptr;
+#endif
+
+int ParseOption(const char *opt) {
+  if (!strncmp(opt, "trace=", 6)) {
+    trace_path = opt + 6;
+#ifndef TRACE_ENABLED
+    fprintf(stderr, "warn: --trace ignored, simulator built with TRACE=none\n");
 #endif
+  } else if (!strncmp(opt, "trace-start=", 12)) {
+    trace_start = strtoull(opt + 12, NULL, 0) * 1000ULL;
+  } else if (!strncmp(opt, "trace-end=", 10)) {
+    trace_end = strtoull(opt + 10, NULL, 0) * 1000ULL;
+  } else if (!strncmp(opt, "stream-chunk=", 13)) {
+    stream_chunk = strtoull(opt + 13, NULL, 0);
+    if (!stream_chunk) {
+      fprintf(stderr, "--stream-chunk must be at least 1\n");
+      return -1;
+    }
+  } else {
+    fprintf(stderr, "unknown option --%s\n", opt);
+    return -1;
+  }
+  return 0;
+}
+
+static void TraceDump() {
+#ifdef TRACE_ENABLED
+  if (!trace || main_time < trace_start)
+    return;
+
+  if (main_time >= trace_end) {
+    // window over, no need to keep the trace open until the end
+    trace->close();
+    delete trace;
+    trace = nullptr;
+    return;
+  }
+  trace->dump(main_time);
+#endif
+}
 
 int InitState(void) {
   char arg0[] = "hw/hw";
   char *vargs[2] = {arg0, NULL};
   Verilated::commandArgs(1, vargs);
 #ifdef TRACE_ENABLED
-  Verilated::traceEverOn(true);
+  if (trace_path)
+    Verilated::traceEverOn(true);
 #endif
   top = new Vtop;
 
 #ifdef TRACE_ENABLED
-  trace = new VerilatedVcdC;
-  top->trace(trace, 99);
-  trace->open("out/debug.vcd");
+  if (trace_path) {
+    trace = new TraceFile;
+    top->trace(trace, 99);
+    trace->open(trace_path);
+  }
 #endif
 
   top->rst = 1;
+
+  stream_chunk = (stream_chunk + dma_beat - 1) / dma_beat * dma_beat;
   return 0;
 }
 
 void Finalize(void) {
-  trace->close();
+  fprintf(stderr, "CLOCK CYCLES = %lu\n", clock_cycles);
+  fprintf(stderr, "GATED CYCLES = %lu\n", gated_cycles);
+#ifdef TRACE_ENABLED
+  if (trace)
+    trace->close();
+#endif
 }
 
-static bool MMIOReadDMA(volatile struct SimbricksProtoPcieH2DRead *read) {
-  uint64_t val = 0;
+static DMAOp *DMAOpNew(DMACtx *c, uint64_t addr, uint64_t off, uint64_t len,
+                       bool write) {
+  // round up to whole beats, the port always moves full beats
+  uint64_t buf_len = (len + dma_beat - 1) / dma_beat * dma_beat;
+  DMAOp *op = new DMAOp;
+  op->data = new uint8_t[buf_len]();
+  op->offset = off;
+  op->addr = addr;
+  op->len = len;
+  op->write = write;
+  op->descs = 0;
+  op->ctx = c;
+  op->state = DMAOp::DMAST_READY;
+  op->pos = 0;
+  op->issued = 0;
+  op->pending = 0;
+  return op;
+}
 
-  switch (read->offset) {
-    case REG_DMA_CTRL:
-      val = dma_op ? REG_DMA_CTRL_RUN : 0;
-      break;
-    case REG_DMA_LEN:
-      val = dma_len;
-      break;
-    case REG_DMA_ADDR:
-      val = dma_addr;
-      break;
-    case REG_DMA_OFF:
-      val = dma_off;
-      break;
-    default:
-      return false;
+static void DMAOpDone(DMACtx *c);
+
+/* make the head of the FIFO the running op. A zero-length op moves nothing
+   through the port or to the host, so it completes as soon as it is there. */
+static void DMAOpNext(DMACtx *c) {
+  c->op = c->queue.empty() ? nullptr : c->queue.front();
+  if (c->op && !c->op->descs && !c->op->len)
+    DMAOpDone(c);
+}
+
+static void DMAOpDone(DMACtx *c) {
+  dprintf("DMA done\n");
+  delete[] c->op->data;
+  delete c->op;
+  c->queue.pop_front();
+  c->done++;
+  c->queued--;
+  DMAOpNext(c);
+}
+
+static void DMAQueue(DMACtx *c, DMAOp *op, uint64_t descs) {
+  c->queue.push_back(op);
+  c->queued += descs;
+  if (!c->op)
+    DMAOpNext(c);
+}
+
+/* host DMA opaque for a descriptor list fetch, otherwise the context index in
+   the upper and the chunk index in the lower 32 bits */
+static const uint64_t kListTag = 1ULL << 63;
+
+static uint64_t DMAOpaque(const DMAOp *op, uint64_t chunk) {
+  return ((uint64_t) (op->ctx - dma_ctx) << 32) | chunk;
+}
+
+/* fetch a list of `count` descriptors and hold its place in the FIFO */
+static void DMAListFetch(DMACtx *c, uint64_t count) {
+  if (c->queued + count > dma_queue_cap) {
+    fprintf(stderr, "warn: DMA queue full, dropping descriptor list\n");
+    return;
   }
 
-  assert(read->len == 8);
+  DMAOp *op = new DMAOp;
+  op->data = new uint8_t[count * sizeof(struct dma_desc)];
+  op->addr = c->sg_addr;
+  op->descs = count;
+  op->ctx = c;
+  IssueDMARead(op->data, op->addr, count * sizeof(struct dma_desc),
+               kListTag | (uintptr_t) op);
+  c->sg_addr += count * sizeof(struct dma_desc);
+  DMAQueue(c, op, count);
+  dprintf("Fetching DMA list, %lu descriptors\n", count);
+}
+
+/* replace fetched list `list` in the FIFO with its descriptors */
+static void DMAListExpand(DMAOp *list) {
+  DMACtx *c = list->ctx;
+  auto it = std::find(c->queue.begin(), c->queue.end(), list);
+  assert(it != c->queue.end());
+  it = c->queue.erase(it);
+
+  const struct dma_desc *d = (const struct dma_desc *) list->data;
+  std::vector<DMAOp *> ops;
+  for (uint64_t i = 0; i < list->descs; i++)
+    ops.push_back(DMAOpNew(c, d[i].addr, d[i].off, d[i].len,
+                           d[i].ctrl & REG_DMA_CTRL_W));
+  c->queue.insert(it, ops.begin(), ops.end());
+  DMAOpNext(c);
+
+  delete[] list->data;
+  delete list;
+}
+
+/******************************************************************************/
+/* Register accesses: the layout is in regs.h, below are the read and write
+   operations of the DMA registers of a context. Registers without operations
+   here are forwarded to the RTL. */
+
+using accelsim::FieldOps;
+using accelsim::RegOps;
+
+static uint64_t ReadDmaCtrl(DMACtx &c, unsigned) {
+  return c.queue.empty() ? 0 : REG_DMA_CTRL_RUN;
+}
+
+static void WriteDmaCtrl(DMACtx &c, unsigned, uint64_t val) {
+  if (!(val & REG_DMA_CTRL_RUN))
+    return;
+
+  if (c.queued >= dma_queue_cap) {
+    fprintf(stderr, "warn: DMA queue full, dropping descriptor\n");
+    return;
+  }
+
+  DMAQueue(&c, DMAOpNew(&c, c.addr, c.off, c.len, val & REG_DMA_CTRL_W), 1);
+  dprintf("Received DMA op, %lu queued\n", c.queued);
+}
+
+static uint64_t ReadDmaQueueCap(DMACtx &, unsigned) {
+  return dma_queue_cap;
+}
+
+static void WriteDmaSgCount(DMACtx &c, unsigned, uint64_t val) {
+  if (val)
+    DMAListFetch(&c, val);
+}
+
+#define FIELD(x) FieldOps<DMACtx, &DMACtx::x>::Read, \
+    FieldOps<DMACtx, &DMACtx::x>::Write
+
+static constexpr RegOps<DMACtx> kRegOps[] = {
+  {"SIZE", nullptr, nullptr},
+  {"CTRL", nullptr, nullptr},
+  {"OFF_INA", nullptr, nullptr},
+  {"OFF_INB", nullptr, nullptr},
+  {"OFF_OUT", nullptr, nullptr},
+  {"BANK", nullptr, nullptr},
+  {"MEM_SIZE", nullptr, nullptr},
+  {"MEM_OFF", nullptr, nullptr},
+  {"DMA_CTRL", ReadDmaCtrl, WriteDmaCtrl},
+  {"DMA_LEN", FIELD(len)},
+  {"DMA_ADDR", FIELD(addr)},
+  {"DMA_OFF", FIELD(off)},
+  {"DMA_QUEUED", FieldOps<DMACtx, &DMACtx::queued>::Read, nullptr},
+  {"DMA_DONE", FieldOps<DMACtx, &DMACtx::done>::Read, nullptr},
+  {"DMA_QUEUE_CAP", ReadDmaQueueCap, nullptr},
+  {"NUM_BANKS", nullptr, nullptr},
+  {"DMA_SG_ADDR", FIELD(sg_addr)},
+  {"DMA_SG_COUNT", nullptr, WriteDmaSgCount},
+  {"NUM_CTX", nullptr, nullptr},
+};
+
+#undef FIELD
+
+static constexpr auto kRegs = accelsim::MakeRegMap<kRegInfo, kRegOps>();
+
+/* DMA registers are handled here, returns false for the RTL's registers */
+static bool MMIOReadDMA(volatile struct SimbricksProtoPcieH2DRead *read) {
+  uint64_t val = 0;
+  if (read->offset >= REG_CTX(dma_max_ctx))
+    return false;
+  DMACtx *c = &dma_ctx[read->offset / REG_CTX_STRIDE];
+  if (!kRegs.Read(*c, read->offset % REG_CTX_STRIDE, read->len, val))
+    return false;
 
   // praepare read completion
   volatile union SimbricksProtoPcieD2H *msg = AllocPcieOut();
@@ -153,44 +399,12 @@ static bool MMIOReadDMA(volatile struct SimbricksProtoPcieH2DRead *read) {
 
 static bool MMIOWriteDMA(volatile struct SimbricksProtoPcieH2DWrite *write) {
   uint64_t val = 0;
+  if (write->offset >= REG_CTX(dma_max_ctx) || write->len > 8)
+    return false;
+  DMACtx *c = &dma_ctx[write->offset / REG_CTX_STRIDE];
 
-  assert(write->len == 8);
-  assert(write->offset % write->len == 0);
   memcpy(&val, (const void *) write->data, write->len);
-
-  switch (write->offset) {
-    case REG_DMA_CTRL:
-      if ((val & REG_DMA_CTRL_RUN)) {
-        if (dma_op) {
-          fprintf(stderr, "warn: starting DMA with already running DMA\n");
-          return true;
-        }
-
-        dma_op = new DMAOp;
-        dma_op->data = new uint8_t[dma_len];
-        dma_op->offset = dma_off;
-        dma_op->addr = dma_addr;
-        dma_op->len = dma_len;
-        dma_op->write = (val & REG_DMA_CTRL_W);
-        dma_op->state = DMAOp::DMAST_READY;
-        dma_op->pos = 0;
-
-        dprintf("Received DMA op\n");
-      }
-      break;
-    case REG_DMA_LEN:
-      dma_len = val;
-      break;
-    case REG_DMA_ADDR:
-      dma_addr = val;
-      break;
-    case REG_DMA_OFF:
-      dma_off = val;
-      break;
-    default:
-      return false;
-  }
-  return true;
+  return kRegs.Write(*c, write->offset % REG_CTX_STRIDE, write->len, val);
 }
 
 void MMIORead(volatile struct SimbricksProtoPcieH2DRead *read) {
@@ -276,65 +490,141 @@ static void MMIOPoll() {
   }
 }
 
-static void DMAPoll() {
-  if (!dma_op)
-    return;
+/* issue the filled but not yet issued part of the buffer to the host */
+static void DMAWriteIssue(DMAOp *op) {
+  uint64_t end = op->pos < op->len ? op->pos : op->len;
+  dprintf("Issuing DMA write: off=%lu len=%lu\n", op->issued,
+    end - op->issued);
+  IssueDMAWrite(op->addr + op->issued, op->data + op->issued,
+    end - op->issued, DMAOpaque(op, 0));
+  op->pending++;
+  op->issued = end;
+}
+
+/* true if the DMA can not make progress until a host DMA completes */
+static bool DMABlocked(const DMAOp *op) {
+  if (op->descs)
+    return true;
+  if (op->write)
+    return op->issued >= op->len;
+  if (op->state == DMAOp::DMAST_READY)
+    return false;
+  return op->pos < op->len && !op->arrived[op->pos / stream_chunk];
+}
 
+/* context that gets the DMA port this cycle: the owner keeps it while its op
+   streams, once that is blocked or done the next context with an op that can
+   make progress takes over, round-robin. Ops only block between beats, so
+   the port is never handed over with a beat in flight. */
+static DMACtx *DMAPortCtx() {
+  DMACtx *c = &dma_ctx[dma_port];
+  if (c->op && c->op->state == DMAOp::DMAST_TRANSFERING && !DMABlocked(c->op))
+    return c;
+  for (size_t i = 1; i <= dma_max_ctx; i++) {
+    size_t idx = (dma_port + i) % dma_max_ctx;
+    if (dma_ctx[idx].op && !DMABlocked(dma_ctx[idx].op)) {
+      dma_port = idx;
+      return &dma_ctx[idx];
+    }
+  }
+  return nullptr;
+}
+
+static void DMAPoll() {
   top->dma_w_req = 0;
   top->dma_r_req = 0;
-  if (dma_op->write) {
-    if (dma_op->state == DMAOp::DMAST_READY) {
+
+  DMACtx *c = DMAPortCtx();
+  if (!c)
+    return;
+
+  DMAOp *op = c->op;
+  if (op->write) {
+    if (op->state == DMAOp::DMAST_READY) {
       dprintf("starting DMA Write op\n");
       top->dma_r_req = 1;
-      top->dma_r_addr = dma_op->offset;
-      dma_op->state = DMAOp::DMAST_TRANSFERING;
-      dma_op->pos = 0;
-    } else if (dma_op->state == DMAOp::DMAST_TRANSFERING) {
-      dprintf("starting Stepping DMA Write\n");
-      memcpy(dma_op->data + dma_op->pos, &top->dma_r_data,
-        sizeof(top->dma_r_data));
-      dma_op->pos += sizeof(top->dma_r_data);
-
-      if (dma_op->pos >= dma_op->len) {
-        dprintf("Write transfer done, issuing\n");
-        IssueDMAWrite(dma_op->addr, dma_op->data, dma_op->len, 0);
-        dma_op->state = DMAOp::DMAST_ISSUED;
-      } else {
-        dprintf("starting continuing DMA read\n");
+      top->dma_r_addr = op->offset;
+      op->state = DMAOp::DMAST_TRANSFERING;
+      op->pos = 0;
+    } else if (op->pos < op->len) {
+      dprintf("Stepping DMA Write: pos=%lu\n", op->pos);
+      memcpy(op->data + op->pos, &top->dma_r_data, dma_beat);
+      op->pos += dma_beat;
+
+      if (op->pos >= op->len || op->pos - op->issued >= stream_chunk)
+        DMAWriteIssue(op);
+      if (op->pos < op->len) {
         top->dma_r_req = 1;
-        top->dma_r_addr = dma_op->offset + dma_op->pos;
+        top->dma_r_addr = op->offset + op->pos;
       }
     }
   } else {
-    if (dma_op->state == DMAOp::DMAST_READY) {
-      dprintf("starting Issuning Read op: A=%lx O=%lx L=%lu \n",
-        dma_op->addr, dma_op->offset, dma_op->len);
-      IssueDMARead(dma_op->data, dma_op->addr, dma_op->len, 0);
-      dma_op->state = DMAOp::DMAST_ISSUED;
-    } else if (dma_op->state == DMAOp::DMAST_TRANSFERING) {
-      dprintf("Stepping Read op: pos=%lu\n", dma_op->pos);
-      if (dma_op->pos >= dma_op->len) {
-        dprintf("Read done\n");
-        delete[] dma_op->data;
-        delete dma_op;
-        dma_op = nullptr;
-      } else {
-        dprintf("Read continuing\n");
-        top->dma_w_req = 1;
-        top->dma_w_addr = dma_op->offset + dma_op->pos;
-        memcpy(&top->dma_w_data, dma_op->data + dma_op->pos,
-          sizeof(top->dma_w_data));
-        dma_op->pos += sizeof(top->dma_w_data);
+    if (op->state == DMAOp::DMAST_READY) {
+      dprintf("starting Issuing Read op: A=%lx O=%lx L=%lu \n",
+        op->addr, op->offset, op->len);
+      uint64_t n = (op->len + stream_chunk - 1) / stream_chunk;
+      op->arrived.assign(n, false);
+      for (uint64_t i = 0; i < n; i++) {
+        uint64_t off = i * stream_chunk;
+        uint64_t len = op->len - off;
+        if (len > stream_chunk)
+          len = stream_chunk;
+        IssueDMARead(op->data + off, op->addr + off, len, DMAOpaque(op, i));
+        op->pending++;
       }
+      op->state = DMAOp::DMAST_TRANSFERING;
+    } else if (op->pos >= op->len) {
+      // all chunks have arrived once the last beat went into the RTL
+      DMAOpDone(c);
+    } else {
+      dprintf("Stepping Read op: pos=%lu\n", op->pos);
+      top->dma_w_req = 1;
+      top->dma_w_addr = op->offset + op->pos;
+      memcpy(&top->dma_w_data, op->data + op->pos, dma_beat);
+      op->pos += dma_beat;
     }
   }
 }
 
+/* true if no context's DMA can make progress without a host DMA completing */
+static bool DMAIdle() {
+  for (size_t i = 0; i < dma_max_ctx; i++) {
+    if (dma_ctx[i].op && !DMABlocked(dma_ctx[i].op))
+      return false;
+  }
+  return true;
+}
+
+static bool RTLIdle() {
+  return !top->rst && top->idle && mmio_queue.empty() && !mmio_submitted &&
+    DMAIdle();
+}
+
 void PollEvent(void) {
+  if (gated) {
+    if (RTLIdle())
+      return;
+
+    // work arrived, resume clocking at the next rising edge on the grid
+    uint64_t skipped = 0;
+    if (main_time > next_edge)
+      skipped = (main_time - next_edge + clock_period - 1) / clock_period;
+    next_edge += skipped * clock_period;
+    gated_cycles += skipped;
+    gated = false;
+    dprintf("ungating clock after %lu cycles\n", skipped);
+  }
+
   if (main_time < next_edge)
     return;
 
+  if (next_rising && RTLIdle()) {
+    gated = true;
+    return;
+  }
+
   if (next_rising) {
+    clock_cycles++;
     MMIOPoll();
     DMAPoll();
   }
@@ -344,9 +634,7 @@ void PollEvent(void) {
   next_rising = !next_rising;
 
   top->eval();
-#ifdef TRACE_ENABLED
-  trace->dump(main_time);
-#endif
+  TraceDump();
 
   if (!reset_done && !next_rising) {
     top->rst = 0;
@@ -357,16 +645,24 @@ void PollEvent(void) {
 }
 
 uint64_t NextEvent(void) {
-  return next_edge;
+  return gated ? UINT64_MAX : next_edge;
 }
 
 void DMACompleteEvent(uint64_t opaque) {
-  dprintf("DMA Completed\n");
-  if (dma_op->write) {
-    delete dma_op->data;
-    delete dma_op;
-    dma_op = nullptr;
+  dprintf("DMA Completed: %lu\n", opaque);
+  if (opaque & kListTag) {
+    DMAListExpand((DMAOp *) (uintptr_t) (opaque & ~kListTag));
+    return;
+  }
+
+  DMACtx *c = &dma_ctx[opaque >> 32];
+  DMAOp *op = c->op;
+  assert(op && op->pending > 0);
+  op->pending--;
+  if (op->write) {
+    if (op->issued >= op->len && op->pending == 0)
+      DMAOpDone(c);
   } else {
-    dma_op->state = DMAOp::DMAST_TRANSFERING;
+    op->arrived[opaque & 0xffffffff] = true;
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Standalone benchmark for the RTL multipliers, without the full system
+   simulation: loads random tiles through the DMA port, runs the multiplier,
+   reads the output back and checks it. Reports cycles per tile (from starting
+   the operation until the design is idle again) and the simulation speed
+   (cycles, including DMA, per second of wall clock time).
+
+   Usage: tilebench NAME [TILES] */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+#include "../common/reg_defs.h"
+}
+#include <Vtop.h>
+
+static Vtop *top;
+static uint64_t cycles = 0;
+static const size_t dma_beat = sizeof(top->dma_w_data);
+
+static void Tick() {
+  top->clk = 0;
+  top->eval();
+  top->clk = 1;
+  top->eval();
+  cycles++;
+}
+
+static uint64_t MMIORead(uint64_t off) {
+  top->mmio_r_req = 1;
+  top->mmio_r_addr = off;
+  Tick();
+  top->mmio_r_req = 0;
+  return top->mmio_r_data;
+}
+
+static void MMIOWrite(uint64_t off, uint64_t val) {
+  top->mmio_w_req = 1;
+  top->mmio_w_addr = off;
+  top->mmio_w_data = val;
+  Tick();
+  top->mmio_w_req = 0;
+}
+
+/* len must be a multiple of the DMA beat */
+static void DMAWrite(uint64_t off, const uint8_t *data, size_t len) {
+  for (size_t pos = 0; pos < len; pos += dma_beat) {
+    top->dma_w_req = 1;
+    top->dma_w_addr = off + pos;
+    memcpy(&top->dma_w_data, data + pos, dma_beat);
+    Tick();
+  }
+  top->dma_w_req = 0;
+}
+
+static void DMARead(uint64_t off, uint8_t *data, size_t len) {
+  for (size_t pos = 0; pos < len; pos += dma_beat) {
+    top->dma_r_req = 1;
+    top->dma_r_addr = off + pos;
+    Tick();
+    memcpy(data + pos, &top->dma_r_data, dma_beat);
+  }
+  top->dma_r_req = 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage: tilebench NAME [TILES]\n");
+    return EXIT_FAILURE;
+  }
+  const char *name = argv[1];
+  unsigned tiles = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000;
+
+  top = new Vtop;
+  top->rst = 1;
+  Tick();
+  Tick();
+  top->rst = 0;
+
+  size_t n = MMIORead(REG_SIZE);
+  uint64_t off_a = MMIORead(REG_OFF_INA);
+  uint64_t off_b = MMIORead(REG_OFF_INB);
+  uint64_t off_out = MMIORead(REG_OFF_OUT);
+  /* whole beats, the memories ignore rows past the tile */
+  size_t len = (n * n + dma_beat - 1) / dma_beat * dma_beat;
+  std::vector<uint8_t> a(len), b(len), out(len);
+  uint64_t timeout = 100 * n * n + 1000;
+
+  srand(42);
+  uint64_t tile_cycles = 0;
+  auto t_start = std::chrono::steady_clock::now();
+  uint64_t c_start = cycles;
+  for (unsigned t = 0; t < tiles; t++) {
+    for (size_t i = 0; i < n * n; i++) {
+      a[i] = rand();
+      b[i] = rand();
+    }
+    DMAWrite(off_a, a.data(), len);
+    DMAWrite(off_b, b.data(), len);
+
+    MMIOWrite(REG_CTRL, REG_CTRL_RUN | REG_CTRL_RSTOUT);
+    uint64_t c = cycles;
+    while (!top->idle) {
+      if (cycles - c > timeout) {
+        printf("BENCH %s %zux%zu: FAILED, multiplier did not finish\n", name,
+               n, n);
+        return EXIT_FAILURE;
+      }
+      Tick();
+    }
+    tile_cycles += cycles - c;
+
+    DMARead(off_out, out.data(), len);
+    /* B is stored transposed, like the driver does */
+    for (size_t i = 0; i < n; i++) {
+      for (size_t j = 0; j < n; j++) {
+        uint8_t sum = 0;
+        for (size_t k = 0; k < n; k++)
+          sum += a[i * n + k] * b[j * n + k];
+        if (out[i * n + j] != sum) {
+          printf("BENCH %s %zux%zu: FAILED, mismatch at (%zu,%zu) in tile %u\n",
+                 name, n, n, i, j, t);
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+  double secs = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - t_start).count();
+
+  printf("BENCH %s %zux%zu: %lu cycles/tile, %.0f kcycles/s simulated\n",
+         name, n, n, tile_cycles / tiles, (cycles - c_start) / secs / 1000);
+  delete top;
+  return EXIT_SUCCESS;
+}
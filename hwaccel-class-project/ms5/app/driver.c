@@ -23,6 +23,7 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -30,9 +31,12 @@
 
 #include <vfio-pci.h>
 #include <dma-alloc.h>
+#include <tile-plan.h>
+#include <utils.h>
 
 #include "../common/reg_defs.h"
 #include "driver.h"
+#include "pack.h"
 
 //#define DEBUG
 #ifdef DEBUG
@@ -43,6 +47,8 @@
 
 /** Use this macro to safely access a register at a specific offset */
 #define ACCESS_REG(r) (*(volatile uint64_t *) ((uintptr_t) regs + r))
+/** Register `r` in the window of context `c` */
+#define CTX_REG(c, r) ACCESS_REG(REG_CTX((c)->idx) + (r))
 
 static void *regs;
 
@@ -57,12 +63,81 @@ size_t matrix_size = -1ULL;
 size_t off_ina;
 size_t off_inb;
 size_t off_out;
+size_t num_banks;
+/* max. output block rows per group in the block schedule, 0 lets the planner
+   choose. Set with the MATMUL_PLAN_ROWS environment variable, for
+   comparison. */
+static size_t plan_rows;
+/* device time of a block multiplication and transfer for the planner,
+   measured in accelerator_init (see measure_cost) */
+static struct tile_cost plan_cost;
+
+static uint64_t dma_queue_cap;
+/* hand descriptors over as lists, or one by one through the DMA registers
+   with MATMUL_DMA_SG=0, for comparison */
+static bool dma_sg = true;
+
+#define DESC_RING_LEN 64
+#define MAX_CTX 16
+
+/** One device context (see REG_CTX) and the thread driving it. Each has its
+ * own banks, DMA FIFO, descriptor ring, and output staging, so threads never
+ * share device state. */
+struct accel_ctx {
+  size_t idx;
+  /* DMA descriptors queued so far, handed to the device, and completed as
+     of the last check */
+  uint64_t dma_submitted;
+  uint64_t dma_flushed;
+  uint64_t dma_completed;
+  /* Descriptors are written into this ring at the end of the dma-able
+     region and handed to the device as scatter-gather lists by dma_flush.
+     Descriptor `seq` sits in slot seq % DESC_RING_LEN, which is only reused
+     once the descriptor there has completed (dma_queue_cap <=
+     DESC_RING_LEN). */
+  volatile struct dma_desc *dma_desc;
+  uintptr_t dma_desc_phys;
+  /* where the device fetches the next list from, 0 if not known */
+  uintptr_t dma_sg_addr;
+  /* output staging in dma_mem_w, one block per output bank */
+  uint8_t *out_buf;
+  uintptr_t out_phys;
+  pthread_t thread;
+};
+
+static struct accel_ctx ctxs[MAX_CTX];
+static size_t num_ctx;
+/* threads (and contexts) matmult_accel uses, MATMUL_THREADS, by default all
+   contexts. Thread 0 is the caller, the others wait in the pool. */
+static size_t num_threads;
+
+/** Block schedule of the current matmult_accel call, shared by the pool:
+ * thread t executes groups t, t + num_threads, ... of the plan on context
+ * t. */
+struct accel_job {
+  struct tile_plan plan;
+  size_t n;
+  uint8_t *out;
+};
+
+static struct accel_job job;
+/* the pool starts on the first barrier and reports back on the second */
+static pthread_barrier_t job_start;
+static pthread_barrier_t job_done;
+
+static void *pool_thread(void *arg);
+static void measure_cost(struct accel_ctx *c, struct tile_cost *cost);
 
 int accelerator_init(bool dma) {
   struct vfio_dev dev;
   size_t reg_len;
 
-  if (vfio_dev_open(&dev, "/dev/vfio/noiommu-0", "0000:00:00.0") != 0) {
+  /* the accelerator sits in a different slot under QEMU */
+  const char *pci_dev = getenv("MATMUL_PCI_DEV");
+  if (!pci_dev)
+    pci_dev = "0000:00:00.0";
+
+  if (vfio_dev_open(&dev, "/dev/vfio/noiommu-0", pci_dev) != 0) {
     fprintf(stderr, "open device failed\n");
     return -1;
   }
@@ -95,6 +170,59 @@ int accelerator_init(bool dma) {
   off_ina = ACCESS_REG(REG_OFF_INA);
   off_inb = ACCESS_REG(REG_OFF_INB);
   off_out = ACCESS_REG(REG_OFF_OUT);
+  num_banks = ACCESS_REG(REG_NUM_BANKS);
+  if (num_banks < 1)
+    num_banks = 1;
+  if (getenv("MATMUL_PLAN_ROWS"))
+    plan_rows = strtoull(getenv("MATMUL_PLAN_ROWS"), NULL, 0);
+  if (getenv("MATMUL_DMA_SG"))
+    dma_sg = strtoull(getenv("MATMUL_DMA_SG"), NULL, 0) != 0;
+
+  num_ctx = ACCESS_REG(REG_NUM_CTX);
+  if (num_ctx < 1)
+    num_ctx = 1;
+  if (num_ctx > MAX_CTX)
+    num_ctx = MAX_CTX;
+  num_threads = num_ctx;
+  if (getenv("MATMUL_THREADS"))
+    num_threads = strtoull(getenv("MATMUL_THREADS"), NULL, 0);
+  if (num_threads < 1 || num_threads > num_ctx)
+    num_threads = num_ctx;
+
+  dma_queue_cap = ACCESS_REG(REG_DMA_QUEUE_CAP);
+  if (dma_queue_cap > DESC_RING_LEN)
+    dma_queue_cap = DESC_RING_LEN;
+
+  /* descriptor rings at the end of the dma-able region, output staging at
+     the start of dma_mem_w */
+  size_t c;
+  for (c = 0; c < num_threads; c++) {
+    struct accel_ctx *ctx = &ctxs[c];
+    size_t ring = (c + 1) * DESC_RING_LEN * sizeof(struct dma_desc);
+    ctx->idx = c;
+    ctx->dma_desc_phys = dma_mem_phys + dma_mem_size - ring;
+    ctx->dma_desc = (volatile struct dma_desc *) (dma_mem + dma_mem_size -
+                                                  ring);
+    ctx->dma_sg_addr = 0;
+    ctx->out_buf = dma_mem_w + c * num_banks * matrix_size * matrix_size;
+    ctx->out_phys = dma_mem_phys_w + c * num_banks * matrix_size *
+      matrix_size;
+    ctx->dma_submitted = ctx->dma_flushed = ctx->dma_completed =
+      CTX_REG(ctx, REG_DMA_DONE);
+  }
+  measure_cost(&ctxs[0], &plan_cost);
+
+  if (pthread_barrier_init(&job_start, NULL, num_threads) ||
+      pthread_barrier_init(&job_done, NULL, num_threads)) {
+    fprintf(stderr, "Initializing thread pool failed\n");
+    return -1;
+  }
+  for (c = 1; c < num_threads; c++) {
+    if (pthread_create(&ctxs[c].thread, NULL, pool_thread, &ctxs[c])) {
+      fprintf(stderr, "Starting thread pool failed\n");
+      return -1;
+    }
+  }
 
   return 0;
 }
@@ -103,60 +231,166 @@ int accelerator_matrix_size(void) {
   return matrix_size;
 }
 
-static inline void put_accel_in(uint64_t dst_off,
-                                const uint8_t *in,
-                                size_t cols,
-                                size_t rows,
-                                size_t in_rowlen,
-                                bool transpose) {
-  size_t i, j;
+/** Hand all descriptors queued with dma_submit to the device, with one
+ * doorbell write per contiguous run in the ring (or four register writes per
+ * descriptor without dma_sg). */
+static inline void dma_flush(struct accel_ctx *c) {
+  for (; !dma_sg && c->dma_flushed < c->dma_submitted; c->dma_flushed++) {
+    volatile struct dma_desc *d =
+      &c->dma_desc[c->dma_flushed % DESC_RING_LEN];
+    CTX_REG(c, REG_DMA_LEN) = d->len;
+    CTX_REG(c, REG_DMA_OFF) = d->off;
+    CTX_REG(c, REG_DMA_ADDR) = d->addr;
+    CTX_REG(c, REG_DMA_CTRL) = REG_DMA_CTRL_RUN | d->ctrl;
+  }
 
-  dprintf("DMA-ing data onto accelerator\n");
-  /** copy into dma-able region */
-  for (i = 0; i < rows; i++) {
-    for (j = 0; j < cols; j++) {
-      uint8_t x = in[i * in_rowlen + j];
-      if (!transpose)
-        dma_mem[i * cols + j] = x;
-      else
-        dma_mem[j * cols + i] = x;
-    }
+  while (c->dma_flushed < c->dma_submitted) {
+    size_t slot = c->dma_flushed % DESC_RING_LEN;
+    uint64_t count = c->dma_submitted - c->dma_flushed;
+    uintptr_t addr = c->dma_desc_phys + slot * sizeof(struct dma_desc);
+    if (count > DESC_RING_LEN - slot)
+      count = DESC_RING_LEN - slot;
+
+    // the device advances its list address past each list
+    if (c->dma_sg_addr != addr)
+      CTX_REG(c, REG_DMA_SG_ADDR) = addr;
+    CTX_REG(c, REG_DMA_SG_COUNT) = count;
+    c->dma_flushed += count;
+    c->dma_sg_addr = addr + count * sizeof(struct dma_desc);
   }
-  ACCESS_REG(REG_DMA_LEN) = cols * rows;
-  ACCESS_REG(REG_DMA_OFF) = dst_off;
-  ACCESS_REG(REG_DMA_ADDR) = dma_mem_phys;
+}
 
-  ACCESS_REG(REG_DMA_CTRL) = REG_DMA_CTRL_RUN;
-  while ((ACCESS_REG(REG_DMA_CTRL) & REG_DMA_CTRL_RUN));
-  dprintf("DMA'd data onto accelerator\n");
+/** Wait for DMA descriptor `seq` (as returned by dma_submit) to complete,
+ * flushing it first if necessary. */
+static inline void dma_wait(struct accel_ctx *c, uint64_t seq) {
+  if (c->dma_flushed < seq)
+    dma_flush(c);
+  while (c->dma_completed < seq)
+    c->dma_completed = CTX_REG(c, REG_DMA_DONE);
 }
 
-static inline void get_accel_out(uint8_t *out,
-                                 uint64_t src_off,
-                                 size_t n,
-                                 size_t out_rowlen) {
-  size_t i, j;
-  dprintf("DMA-ing data out of accelerator\n");
-  ACCESS_REG(REG_DMA_LEN) = n * n;
-  ACCESS_REG(REG_DMA_OFF) = src_off;
-  ACCESS_REG(REG_DMA_ADDR) = dma_mem_phys_w;
+/** Queue a DMA descriptor without waiting for it, returns its sequence
+ * number. The device only sees it after the next dma_flush. */
+static inline uint64_t dma_submit(struct accel_ctx *c, uint64_t dev_off,
+                                  uintptr_t phys, size_t len, uint64_t ctrl) {
+  // only block if the descriptor FIFO is full
+  if (c->dma_submitted - c->dma_completed >= dma_queue_cap)
+    dma_wait(c, c->dma_submitted + 1 - dma_queue_cap);
+
+  volatile struct dma_desc *d =
+    &c->dma_desc[c->dma_submitted % DESC_RING_LEN];
+  d->addr = phys;
+  d->off = dev_off;
+  d->len = len;
+  d->ctrl = ctrl;
+  return ++c->dma_submitted;
+}
 
-  ACCESS_REG(REG_DMA_CTRL) = REG_DMA_CTRL_RUN | REG_DMA_CTRL_W;
-  while ((ACCESS_REG(REG_DMA_CTRL) & REG_DMA_CTRL_RUN));
+/** Offset of bank `bank` of the memory at `off` for context `c`. */
+static inline uint64_t ctx_bank(const struct accel_ctx *c, uint64_t off,
+                                size_t bank) {
+  return off + (c->idx * num_banks + bank) * matrix_size * matrix_size;
+}
+
+/** Queue the DMA of a `len` byte block, packed at `stage` in the dma-able
+ * region, onto the accelerator at `dst_off`. Returns the DMA's sequence
+ * number. */
+static inline uint64_t put_accel_in(struct accel_ctx *c, uint64_t dst_off,
+                                    size_t stage, size_t len) {
+  dprintf("DMA-ing data onto accelerator\n");
+  return dma_submit(c, dst_off, dma_mem_phys + stage, len, 0);
+}
 
+/** Queue the DMA of the output block in `bank` into its part of the
+ * context's staging. Returns the DMA's sequence number, pass to
+ * copy_accel_out once it is done. */
+static inline uint64_t get_accel_out(struct accel_ctx *c, size_t bank,
+                                     size_t n) {
+  dprintf("DMA-ing data out of accelerator\n");
+  return dma_submit(c, ctx_bank(c, off_out, bank), c->out_phys + bank * n * n,
+                    n * n, REG_DMA_CTRL_W);
+}
+
+/** Wait for output DMA `seq` of `bank` and copy the block to `out`. */
+static inline void copy_accel_out(struct accel_ctx *c,
+                                  uint8_t *out,
+                                  uint64_t seq,
+                                  size_t bank,
+                                  size_t n,
+                                  size_t out_rowlen) {
+  size_t i;
+  const uint8_t *buf = c->out_buf + bank * n * n;
+
+  dma_wait(c, seq);
   for (i = 0; i < n; i++)
-    for (j = 0; j < n; j += 8)
-      *(uint64_t *) (out + (i * out_rowlen + j)) +=
-        *(uint64_t *) &dma_mem_w[i * n + j];
+    memcpy(out + i * out_rowlen, buf + i * n, n);
   dprintf("DMA'd data out of accelerator\n");
 }
 
-static inline void exec_accel()
+/** One multiplication of a block schedule: A(i, k) times B(k, j), added onto
+ * output block (i, j), row `r` of its group (see tile_plan). */
+struct accel_op {
+  size_t i, j, k, r;
+  size_t in_bank;
+  size_t out_bank;
+  bool load_a;
+  bool load_b;
+};
+
+/** Operation number `b` of `plan`. Input banks hold an A and a B tile each,
+ * so A slots of the plan are input banks. */
+static void plan_op(const struct tile_plan *plan, size_t b,
+                    struct accel_op *op) {
+  size_t n_b = plan->n_b;
+  size_t group_ops = plan->rows * n_b * n_b;
+  size_t g = b / group_ops * plan->rows;
+  size_t rows = n_b - g < plan->rows ? n_b - g : plan->rows;
+  size_t idx = b % group_ops;
+
+  op->r = idx % rows;
+  op->k = (idx / rows) % n_b;
+  op->j = idx / (rows * n_b);
+  op->i = g + op->r;
+  op->in_bank = plan->a_resident ? op->r * n_b + op->k : b % plan->a_slots;
+  op->out_bank = ((g / plan->rows * n_b + op->j) %
+                  (plan->out_slots / plan->rows)) * plan->rows + op->r;
+  op->load_a = !plan->a_resident || op->j == 0;
+  // a single bank keeps B for the whole group
+  op->load_b = op->r == 0 || plan->b_slots > 1;
+}
+
+/** Queue the input loads of `op` from the packed matrices (see
+ * matmult_accel). Returns the sequence number of the last DMA. */
+static inline uint64_t put_accel_op(struct accel_ctx *c, size_t n,
+                                    const struct accel_op *op) {
+  size_t block = matrix_size;
+  size_t tile = block * block;
+  size_t n_b = n / block;
+  uint64_t seq = c->dma_submitted;
+
+  if (op->load_a)
+    seq = put_accel_in(c, ctx_bank(c, off_ina, op->in_bank),
+                       (op->i * n_b + op->k) * tile, tile);
+  if (op->load_b)
+    seq = put_accel_in(c, ctx_bank(c, off_inb, op->in_bank),
+                       n * n + (op->k * n_b + op->j) * tile, tile);
+  return seq;
+}
+
+/** Start an operation on input bank `in_bank` that overwrites (`rst_out`) or
+ * adds onto output bank `out_bank`. */
+static inline void start_accel(struct accel_ctx *c, size_t in_bank,
+                               size_t out_bank, bool rst_out)
 {
-  dprintf("Executing on accelerator\n");
-  ACCESS_REG(REG_CTRL) = REG_CTRL_RUN;
+  dprintf("Executing on accelerator (banks %zu/%zu)\n", in_bank, out_bank);
+  if (num_banks > 1)
+    CTX_REG(c, REG_BANK) = REG_BANK_IN(in_bank) | REG_BANK_OUT(out_bank);
+  CTX_REG(c, REG_CTRL) = REG_CTRL_RUN | (rst_out ? REG_CTRL_RSTOUT : 0);
+}
 
-  while ((ACCESS_REG(REG_CTRL) & REG_CTRL_RUN));
+static inline void wait_accel(struct accel_ctx *c)
+{
+  while ((CTX_REG(c, REG_CTRL) & REG_CTRL_RUN));
   dprintf("Executed on accelerator\n");
 }
 
@@ -173,6 +407,125 @@ static void dump_matrix(const uint8_t *m, size_t n)
 #endif
 }
 
+/** Index of the `l`-th operation thread `t` executes in the plan of `job`,
+ * SIZE_MAX past its last one. */
+static size_t job_op(const struct accel_job *job, size_t t, size_t l) {
+  const struct tile_plan *plan = &job->plan;
+  size_t n_b = plan->n_b;
+  size_t group_ops = plan->rows * n_b * n_b;
+  size_t g = t + l / group_ops * num_threads;
+  size_t b = g * group_ops + l % group_ops;
+
+  // only the last group can be short
+  if (g * plan->rows >= n_b || b >= n_b * n_b * n_b)
+    return SIZE_MAX;
+  return b;
+}
+
+/** Execute this thread's share of the current job on context `c`. Each
+ * output tile stays on the accelerator for all k, the first operation
+ * overwrites it and the others add onto it, so each output block crosses PCIe
+ * only once. When the next operation uses the other input bank, its inputs
+ * are loaded while the current one computes, and finished output tiles drain
+ * from their bank while the next ones compute. Otherwise the next loads are
+ * queued right after the operation. The loads of an operation and any output
+ * drain queued before them go to the device as one descriptor list, so each
+ * operation takes a single DMA doorbell. */
+static void run_job(struct accel_ctx *c) {
+  size_t block = matrix_size;
+  size_t n = job.n;
+  size_t n_b = n / block;
+  /* output blocks draining, per output bank */
+  uint8_t *pend[2] = { NULL, NULL };
+  uint64_t pend_seq[2] = { 0, 0 };
+  struct accel_op op, next;
+  uint64_t in_seq;
+  size_t l = 0, b, o;
+
+  if ((b = job_op(&job, c->idx, 0)) == SIZE_MAX)
+    return;
+  plan_op(&job.plan, b, &op);
+  in_seq = put_accel_op(c, n, &op);
+  for (;;) {
+    bool overlap = false;
+    size_t b_next = job_op(&job, c->idx, ++l);
+    if (b_next != SIZE_MAX) {
+      plan_op(&job.plan, b_next, &next);
+      overlap = next.in_bank != op.in_bank;
+    }
+
+    dma_wait(c, in_seq);
+    if (pend[op.out_bank]) {
+      copy_accel_out(c, pend[op.out_bank], pend_seq[op.out_bank],
+                     op.out_bank, block, n);
+      pend[op.out_bank] = NULL;
+    }
+    start_accel(c, op.in_bank, op.out_bank, op.k == 0);
+    if (overlap) {
+      in_seq = put_accel_op(c, n, &next);
+      dma_flush(c);
+    }
+    for (o = 0; o < 2; o++) {
+      if (pend[o]) {
+        copy_accel_out(c, pend[o], pend_seq[o], o, block, n);
+        pend[o] = NULL;
+      }
+    }
+    wait_accel(c);
+
+    if (op.k == n_b - 1) {
+      pend_seq[op.out_bank] = get_accel_out(c, op.out_bank, block);
+      pend[op.out_bank] = job.out + ((op.i * block * n) + op.j * block);
+    }
+    if (b_next == SIZE_MAX)
+      break;
+    if (!overlap) {
+      in_seq = put_accel_op(c, n, &next);
+      dma_flush(c);
+    }
+    op = next;
+  }
+  for (o = 0; o < 2; o++) {
+    if (pend[o])
+      copy_accel_out(c, pend[o], pend_seq[o], o, block, n);
+  }
+}
+
+static void *pool_thread(void *arg) {
+  struct accel_ctx *c = arg;
+  for (;;) {
+    pthread_barrier_wait(&job_start);
+    run_job(c);
+    pthread_barrier_wait(&job_done);
+  }
+  return NULL;
+}
+
+/** Cycles for a `len` byte DMA onto bank 0 of context `c`, from queueing the
+ * descriptor until it completes. */
+static uint64_t dma_time(struct accel_ctx *c, size_t len) {
+  uint64_t start = rdtsc();
+  dma_wait(c, put_accel_in(c, ctx_bank(c, off_ina, 0), 0, len));
+  return rdtsc() - start;
+}
+
+/** Measure the device time of one block multiplication and one block load for
+ * the planner on context `c`, before the pool starts. A zero-length DMA
+ * completes without any transfer, so its time is the round trip of handing
+ * over a descriptor, which is subtracted from the load. */
+static void measure_cost(struct accel_ctx *c, struct tile_cost *cost) {
+  size_t tile = matrix_size * matrix_size;
+  uint64_t base = dma_time(c, 0);
+  uint64_t load = dma_time(c, tile);
+  uint64_t start = rdtsc();
+  start_accel(c, 0, 0, true);
+  wait_accel(c);
+  cost->compute = rdtsc() - start;
+  cost->transfer = load > base ? load - base : 0;
+  dprintf("cost: %lu cycles per block load, %lu per multiplication\n",
+          cost->transfer, cost->compute);
+}
+
 void matmult_accel(const uint8_t * restrict A, const uint8_t * restrict B,
                    uint8_t * restrict out, size_t n) {
   if ((int) n < accelerator_matrix_size()) {
@@ -181,7 +534,6 @@ void matmult_accel(const uint8_t * restrict A, const uint8_t * restrict B,
   }
 
   size_t block = matrix_size;
-  size_t i, j, k;
   assert(n % block == 0);
   size_t n_b = n / block;
 
@@ -190,18 +542,32 @@ void matmult_accel(const uint8_t * restrict A, const uint8_t * restrict B,
   dprintf("\nInput B:\n");
   dump_matrix(B, n);
 
-  memset(out, 0, n * n);
-  for (i = 0; i < n_b; i++) {
-    for (j = 0; j < n_b; j++) {
-      for (k = 0; k < n_b; k++) {
-        put_accel_in(off_ina, A + ((i * block * n) + k * block), block, block, n, false);
-        put_accel_in(off_inb, B + ((k * block * n) + j * block), block, block, n, true);
-        exec_accel();
-        get_accel_out(out + ((i * block * n) + j * block), off_out, block, n);
-      }
-      
-    }
+  /* Pack both matrices into the dma-able region once, A and then B, each as
+     contiguous blocks in block-major order with the B blocks transposed for
+     the accelerator. Every load is then a single DMA of a packed block. */
+  if (2 * n * n > dma_mem_size / 2) {
+    fprintf(stderr, "matmult_accel: matrix too large for dma region\n");
+    abort();
   }
+  pack_blocks(dma_mem, A, n, block, false);
+  pack_blocks(dma_mem + n * n, B, n, block, true);
+
+  /* The planner picks the block schedule for the banks of one context (see
+     tile_plan), and the groups of output rows it forms are spread over the
+     threads, each driving its own context (see run_job). */
+  struct tile_mem tmem = { SIZE_MAX, num_banks, num_banks, num_banks, true };
+  if (num_banks > 2 ||
+      tile_plan(&job.plan, n_b, &tmem, &plan_cost, plan_rows)) {
+    fprintf(stderr, "matmult_accel: no block schedule for %zu banks\n",
+            num_banks);
+    abort();
+  }
+  job.n = n;
+  job.out = out;
+
+  pthread_barrier_wait(&job_start);
+  run_job(&ctxs[0]);
+  pthread_barrier_wait(&job_done);
 
   dprintf("Output:\n");
   dump_matrix(out, n);
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "pack.h"
+
+#ifdef __SSE2__
+/* 8x8 transpose: interleave bytes, then 16-bit, then 32-bit pairs */
+static inline void transpose_8x8(uint8_t *dst, size_t dst_stride,
+                                 const uint8_t *src, size_t src_stride) {
+  __m128i r[8], a[4], b[4], c[4];
+  int i;
+
+  for (i = 0; i < 8; i++)
+    r[i] = _mm_loadl_epi64((const __m128i *) (src + i * src_stride));
+  for (i = 0; i < 4; i++)
+    a[i] = _mm_unpacklo_epi8(r[2 * i], r[2 * i + 1]);
+  b[0] = _mm_unpacklo_epi16(a[0], a[1]);
+  b[1] = _mm_unpackhi_epi16(a[0], a[1]);
+  b[2] = _mm_unpacklo_epi16(a[2], a[3]);
+  b[3] = _mm_unpackhi_epi16(a[2], a[3]);
+  c[0] = _mm_unpacklo_epi32(b[0], b[2]);
+  c[1] = _mm_unpackhi_epi32(b[0], b[2]);
+  c[2] = _mm_unpacklo_epi32(b[1], b[3]);
+  c[3] = _mm_unpackhi_epi32(b[1], b[3]);
+  // each c holds two output rows
+  for (i = 0; i < 4; i++) {
+    _mm_storel_epi64((__m128i *) (dst + 2 * i * dst_stride), c[i]);
+    _mm_storel_epi64((__m128i *) (dst + (2 * i + 1) * dst_stride),
+                     _mm_unpackhi_epi64(c[i], c[i]));
+  }
+}
+
+/* 16x16 transpose: four rounds interleaving register i with register i + 8,
+   widening the interleaved element from 8 to 64 bits. Each round takes the
+   rows in bit-reversed order, so we load them that way. */
+static inline void transpose_16x16(uint8_t *dst, size_t dst_stride,
+                                   const uint8_t *src, size_t src_stride) {
+  static const uint8_t rev[16] = {
+    0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15
+  };
+  __m128i a[16], b[16];
+  int i;
+
+  for (i = 0; i < 16; i++)
+    a[i] = _mm_loadu_si128((const __m128i *) (src + rev[i] * src_stride));
+  for (i = 0; i < 8; i++) {
+    b[2 * i] = _mm_unpacklo_epi8(a[i], a[i + 8]);
+    b[2 * i + 1] = _mm_unpackhi_epi8(a[i], a[i + 8]);
+  }
+  for (i = 0; i < 8; i++) {
+    a[2 * i] = _mm_unpacklo_epi16(b[i], b[i + 8]);
+    a[2 * i + 1] = _mm_unpackhi_epi16(b[i], b[i + 8]);
+  }
+  for (i = 0; i < 8; i++) {
+    b[2 * i] = _mm_unpacklo_epi32(a[i], a[i + 8]);
+    b[2 * i + 1] = _mm_unpackhi_epi32(a[i], a[i + 8]);
+  }
+  for (i = 0; i < 8; i++) {
+    a[2 * i] = _mm_unpacklo_epi64(b[i], b[i + 8]);
+    a[2 * i + 1] = _mm_unpackhi_epi64(b[i], b[i + 8]);
+  }
+  for (i = 0; i < 16; i++)
+    _mm_storeu_si128((__m128i *) (dst + i * dst_stride), a[i]);
+}
+#endif
+
+void transpose_tile(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+                    size_t src_stride, size_t block) {
+  size_t i, j;
+
+#ifdef __SSE2__
+  size_t sub = block % 16 == 0 ? 16 : block % 8 == 0 ? 8 : 0;
+  if (sub) {
+    // sub-tile (i, j) of src is transposed into sub-tile (j, i) of dst
+    for (i = 0; i < block; i += sub) {
+      for (j = 0; j < block; j += sub) {
+        if (sub == 16)
+          transpose_16x16(dst + j * dst_stride + i, dst_stride,
+                          src + i * src_stride + j, src_stride);
+        else
+          transpose_8x8(dst + j * dst_stride + i, dst_stride,
+                        src + i * src_stride + j, src_stride);
+      }
+    }
+    return;
+  }
+#endif
+
+  for (i = 0; i < block; i++)
+    for (j = 0; j < block; j++)
+      dst[j * dst_stride + i] = src[i * src_stride + j];
+}
+
+void pack_blocks(uint8_t *dst, const uint8_t *src, size_t n, size_t block,
+                 bool transpose) {
+  size_t n_b = n / block;
+  size_t bi, bj, r;
+
+  for (bi = 0; bi < n_b; bi++) {
+    for (bj = 0; bj < n_b; bj++) {
+      const uint8_t *in = src + bi * block * n + bj * block;
+      if (transpose) {
+        transpose_tile(dst, block, in, n, block);
+      } else {
+        for (r = 0; r < block; r++)
+          memcpy(dst + r * block, in + r * n, block);
+      }
+      dst += block * block;
+    }
+  }
+}
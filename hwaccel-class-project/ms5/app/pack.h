@@ -0,0 +1,49 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PACK_H_
+#define PACK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Transpose a `block` x `block` byte tile from `src` into `dst`, with rows
+ * `src_stride` and `dst_stride` bytes apart. Uses SSE2 kernels for 8x8 and
+ * 16x16 sub-tiles when `block` is a multiple of 8.
+ */
+void transpose_tile(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+                    size_t src_stride, size_t block);
+
+/**
+ * Pack the n x n matrix `src` into block-major layout in `dst`: the
+ * (n / block)^2 blocks one after the other in row-major block order, each
+ * block contiguous and row-major, or transposed with `transpose`. `n` must
+ * be a multiple of `block`.
+ */
+void pack_blocks(uint8_t *dst, const uint8_t *src, size_t n, size_t block,
+                 bool transpose);
+
+#endif  // ndef PACK_H_
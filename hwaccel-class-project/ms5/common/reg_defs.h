@@ -5,41 +5,55 @@
    YOU ARE WELCOME TO CHANGE THIS HOWEVER YOU LIKE!
 */
 
-/** Size register: contains supported matrix size (width/height). read-only */
-#define REG_SIZE 0x00
+#include <stdint.h>
+
+/* Register offsets (REG_*) are generated from accel-sim/regs.h, edit them
+   there and run `make common/reg_map.h`. */
+#include "reg_map.h"
 
-/** Control register: used to start the accelerator/wait for completion.
-    read/write */
-#define REG_CTRL 0x08
 /** Run bit in the control register, set to start, then wait for device to clear
     this back to 0.*/
 #define REG_CTRL_RUN 0x01
-/** Reset bit for output buffer. When set, clears the output buffer to 0. */
+/** Reset bit for output buffer. When set, the operation overwrites the output
+    buffer, otherwise it adds its result onto the current output buffer. */
 #define REG_CTRL_RSTOUT 0x02
 
-/** Registers specifying offset for input and output matrices in the accelerator
- * memory. now read-writeable. */
-#define REG_OFF_INA 0x10
-#define REG_OFF_INB 0x18
-#define REG_OFF_OUT 0x20
-
-/** Register containing size of the on-accelerator memory. read-only */
-#define REG_MEM_SIZE 0x30
-/** Register containing offset of the accelerator memory. read-only */
-#define REG_MEM_OFF 0x38
-
+/** REG_BANK values: input bank in the low bit, output bank in the bit above */
+#define REG_BANK_IN(b) ((b) & 1)
+#define REG_BANK_OUT(b) (((b) & 1) << 1)
 
-/** DMA Control register. */
-#define REG_DMA_CTRL 0x40
 /** Bit to request start of DMA operation */
 #define REG_DMA_CTRL_RUN 0x1
 /** Bit to request DMA Write (device to host), if 0 the operation is a read
  * instead (host to device). */
 #define REG_DMA_CTRL_W   0x2
 
-/** Register holding requested length of the DMA operation in bytes */
-#define REG_DMA_LEN  0x48
-/** Register holding *physical* address on the host. */
-#define REG_DMA_ADDR 0x50
-/** Register holding memory offset on the accelerator. */
-#define REG_DMA_OFF  0x58
+/* Setting REG_DMA_CTRL_RUN queues a descriptor with the current LEN, ADDR, and
+ * OFF values in a FIFO, descriptors are executed in order. REG_DMA_CTRL reads
+ * REG_DMA_CTRL_RUN while any descriptor is queued or running. Descriptors
+ * written while the FIFO is full are dropped. */
+
+/* Scatter-gather: writing REG_DMA_SG_COUNT fetches that many struct dma_desc
+ * from host physical address REG_DMA_SG_ADDR and queues them in the FIFO, in
+ * order and behind anything queued before, as if each was written through the
+ * registers above. REG_DMA_SG_ADDR then advances past the list, so lists laid
+ * out back to back in host memory only need REG_DMA_SG_COUNT written. The
+ * list is dropped if its descriptors do not fit in the FIFO. */
+
+/** DMA descriptor in a scatter-gather list, fields as the registers above,
+ * `ctrl` takes REG_DMA_CTRL_W. */
+struct dma_desc {
+  uint64_t addr;
+  uint64_t off;
+  uint64_t len;
+  uint64_t ctrl;
+};
+
+/* Contexts: devices with more than one context (REG_NUM_CTX > 1) repeat all
+ * registers above in one window per context, context c's registers start at
+ * REG_CTX(c) and operate on that context's banks and DMA FIFO only. Bank b of
+ * context c starts (c * REG_NUM_BANKS + b) * size * size bytes after each
+ * REG_OFF_* offset. Contexts run independently, so separate threads can each
+ * drive one without locking. */
+#define REG_CTX_STRIDE 0x100
+#define REG_CTX(c) ((c) * REG_CTX_STRIDE)
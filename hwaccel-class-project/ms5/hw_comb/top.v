@@ -66,7 +66,12 @@ module top #(parameter
 
   input   dma_r_req,
   input   [DMA_ADDRBITS-1:0] dma_r_addr,
-  output  [DMA_WIDTH-1:0] dma_r_data
+  output  [DMA_WIDTH-1:0] dma_r_data,
+
+  /* 1 when a clock edge would not change any state (nothing is running). The
+     simulation harness stops clocking the design while it is idle and no MMIO
+     or DMA request is pending. Tie to 0 to always clock. */
+  output  idle
 );
 
   /* dma offsets for the matric memories */
@@ -121,6 +126,21 @@ module top #(parameter
 
   /* control register indicating if operation is currently running */
   reg running;
+  assign idle = !running;
+  /* operation adds onto the output memory instead of overwriting it
+     (REG_CTRL_RSTOUT not set) */
+  reg acc;
+
+  /* output of the multiply unit, in accumulate mode added element-wise onto
+     the current output memory contents */
+  reg [MUL_SIZE * MUL_SIZE * 8 - 1:0] out_sum;
+  integer p;
+  always @ (*) begin
+    for (p = 0; p < MUL_SIZE * MUL_SIZE; p = p + 1) begin
+      out_sum[p * 8 +: 8] = out[p * 8 +: 8] +
+        (acc ? outmem[(p * 8) / DMA_WIDTH][(p * 8) % DMA_WIDTH +: 8] : 8'd0);
+    end
+  end
 
   /* actual state machine: evaluated at every rising clock edge */
   always @ (posedge clk) begin
@@ -129,13 +149,14 @@ module top #(parameter
          state. */
       running <= 0;
       mmio_r_result <= 0;
+      acc <= 0;
     end else begin
       /* state machine to keep accelerator running for exactly one cycle before
          writing output to memory and clearing running bit */
       if (running) begin
         integer m;
         for (m = 0; m < MEMSZ; m = m + 1) begin
-          outmem[m] <= out[m * DMA_WIDTH +: DMA_WIDTH];
+          outmem[m] <= out_sum[m * DMA_WIDTH +: DMA_WIDTH];
         end
         running <= 0;
       end
@@ -144,7 +165,10 @@ module top #(parameter
       if (mmio_w_req) begin
         case (mmio_w_addr)
           /* only the control register is writable */
-          'h08: running <= mmio_w_data[0];
+          'h08: begin
+            running <= mmio_w_data[0];
+            acc <= !mmio_w_data[1];
+          end
         endcase
       end
 
@@ -160,6 +184,12 @@ module top #(parameter
           'h10: mmio_r_result <= OFF_INA;
           'h18: mmio_r_result <= OFF_INB;
           'h20: mmio_r_result <= OFF_OUT;
+          /* bank register: only one bank */
+          'h28: mmio_r_result <= 0;
+          /* number of banks */
+          'h78: mmio_r_result <= 1;
+          /* number of contexts: only one */
+          'h90: mmio_r_result <= 1;
         endcase
       end
 
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2023 Max Planck Institute for Software Systems, and
+ * National University of Singapore
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Systolic-array matrix multiply: a MUL_SIZE x MUL_SIZE grid of processing
+   elements (PEs), output-stationary. PE (i,j) accumulates output element
+   (i,j). Elements of A flow right along the rows of the grid, elements of B
+   flow down the columns, one PE per cycle. Row i of A enters the grid i cycles
+   late, column j of B j cycles late, so A[i][k] and B[k][j] meet in PE (i,j)
+   at step i + j + k.
+
+   An operation runs in three phases:
+   - load: read one row of A and one row of (transposed) B per cycle into
+     the operand shift registers (MUL_SIZE cycles)
+   - run: step the grid (3 * MUL_SIZE - 2 cycles)
+   - drain: write one output row per cycle (MUL_SIZE cycles) */
+module matmul_sys #(parameter
+  MUL_SIZE = 8,
+  ADDR_BITS = $clog2(MUL_SIZE)
+) (
+  input  clk,
+  input  rst,
+
+  input start_mul,
+  output mul_done,
+
+  output [ADDR_BITS - 1:0] a_addr,
+  input  [MUL_SIZE * 8 - 1:0] a_data,
+
+  output [ADDR_BITS - 1:0] b_addr,
+  input [MUL_SIZE * 8 - 1:0] b_data,
+
+  /* add onto the previous output row (out_prev) instead of overwriting it */
+  input acc,
+  input [MUL_SIZE * 8 - 1:0] out_prev,
+
+  output [ADDR_BITS - 1:0] out_addr,
+  output [MUL_SIZE * 8 - 1:0] out_data,
+  output out_we
+);
+  parameter RUN_STEPS = 3 * MUL_SIZE - 2;
+  parameter CNT_BITS = $clog2(RUN_STEPS);
+
+  localparam S_IDLE = 2'd0;
+  localparam S_LOAD = 2'd1;
+  localparam S_RUN = 2'd2;
+  localparam S_DRAIN = 2'd3;
+
+  reg [1:0] state;
+  /* row (load, drain) or step (run) counter */
+  reg [CNT_BITS - 1:0] cnt;
+
+  /* operand shift registers: row i of A and column j of B (row j of the B
+     memory), shifted out one element per step once their turn has come */
+  reg [MUL_SIZE * 8 - 1:0] arow [0:MUL_SIZE - 1];
+  reg [MUL_SIZE * 8 - 1:0] bcol [0:MUL_SIZE - 1];
+
+  assign a_addr = cnt[ADDR_BITS - 1:0];
+  assign b_addr = cnt[ADDR_BITS - 1:0];
+
+  /* verilator lint_off WIDTH */
+  integer r;
+  always @(posedge clk) begin
+    if (rst) begin
+      state <= S_IDLE;
+      cnt <= 0;
+    end else begin
+      case (state)
+        S_IDLE: if (start_mul) begin
+          state <= S_LOAD;
+          cnt <= 0;
+        end
+        S_LOAD: begin
+          arow[cnt[ADDR_BITS - 1:0]] <= a_data;
+          bcol[cnt[ADDR_BITS - 1:0]] <= b_data;
+          if (cnt == MUL_SIZE - 1) begin
+            state <= S_RUN;
+            cnt <= 0;
+          end else begin
+            cnt <= cnt + 1;
+          end
+        end
+        S_RUN: begin
+          /* shifting in zeros keeps feeding zeros once a row is done */
+          for (r = 0; r < MUL_SIZE; r = r + 1) begin
+            if (cnt >= r) begin
+              arow[r] <= arow[r] >> 8;
+              bcol[r] <= bcol[r] >> 8;
+            end
+          end
+          if (cnt == RUN_STEPS - 1) begin
+            state <= S_DRAIN;
+            cnt <= 0;
+          end else begin
+            cnt <= cnt + 1;
+          end
+        end
+        S_DRAIN: begin
+          if (cnt == MUL_SIZE - 1) begin
+            state <= S_IDLE;
+            cnt <= 0;
+          end else begin
+            cnt <= cnt + 1;
+          end
+        end
+      endcase
+    end
+  end
+
+  /* skewed grid inputs: A elements from the left, B elements from the top */
+  wire [MUL_SIZE * 8 - 1:0] left_in;
+  wire [MUL_SIZE * 8 - 1:0] top_in;
+  /* registered operands each PE passes on to its right / lower neighbour
+     (unused for the last column / row) */
+  /* verilator lint_off UNUSED */
+  wire [MUL_SIZE * MUL_SIZE * 8 - 1:0] a_pass;
+  wire [MUL_SIZE * MUL_SIZE * 8 - 1:0] b_pass;
+  /* verilator lint_on UNUSED */
+  /* accumulated output elements, row-major */
+  wire [MUL_SIZE * MUL_SIZE * 8 - 1:0] sums;
+
+  genvar i, j;
+  generate
+    for (i = 0; i < MUL_SIZE; i = i + 1) begin : feed
+      assign left_in[i * 8 +: 8] = (cnt >= i) ? arow[i][7:0] : 8'd0;
+      assign top_in[i * 8 +: 8] = (cnt >= i) ? bcol[i][7:0] : 8'd0;
+    end
+
+    for (i = 0; i < MUL_SIZE; i = i + 1) begin : pe_row
+      for (j = 0; j < MUL_SIZE; j = j + 1) begin : pe_col
+        wire [7:0] a_in;
+        wire [7:0] b_in;
+        if (j == 0) begin : a_edge
+          assign a_in = left_in[i * 8 +: 8];
+        end else begin : a_inner
+          assign a_in = a_pass[(i * MUL_SIZE + j - 1) * 8 +: 8];
+        end
+        if (i == 0) begin : b_edge
+          assign b_in = top_in[j * 8 +: 8];
+        end else begin : b_inner
+          assign b_in = b_pass[((i - 1) * MUL_SIZE + j) * 8 +: 8];
+        end
+
+        matmul_sys_pe pe (
+          .clk(clk),
+          .clr(rst || start_mul),
+          .en(state == S_RUN),
+          .a_in(a_in),
+          .b_in(b_in),
+          .a_out(a_pass[(i * MUL_SIZE + j) * 8 +: 8]),
+          .b_out(b_pass[(i * MUL_SIZE + j) * 8 +: 8]),
+          .sum(sums[(i * MUL_SIZE + j) * 8 +: 8])
+        );
+      end
+    end
+  endgenerate
+
+  /* drain: output row cnt, element-wise (8-bit) sum with the previous output
+     row when accumulating */
+  wire [MUL_SIZE * 8 - 1:0] c_row = sums[cnt * MUL_SIZE * 8 +: MUL_SIZE * 8];
+
+  genvar e;
+  generate
+    for (e = 0; e < MUL_SIZE; e = e + 1) begin : accum
+      assign out_data[e * 8 +: 8] =
+        c_row[e * 8 +: 8] + (acc ? out_prev[e * 8 +: 8] : 8'd0);
+    end
+  endgenerate
+
+  assign out_addr = cnt[ADDR_BITS - 1:0];
+  assign out_we = (state == S_DRAIN);
+  assign mul_done = (state == S_DRAIN) && (cnt == MUL_SIZE - 1);
+  /* verilator lint_on WIDTH */
+endmodule
+
+/* One processing element: passes its operands on to the neighbours and
+   accumulates their product (8-bit, wrapping like the other designs). */
+module matmul_sys_pe (
+  input clk,
+  input clr,
+  input en,
+  input [7:0] a_in,
+  input [7:0] b_in,
+  output reg [7:0] a_out,
+  output reg [7:0] b_out,
+  output reg [7:0] sum
+);
+  always @(posedge clk) begin
+    if (clr) begin
+      a_out <= 0;
+      b_out <= 0;
+      sum <= 0;
+    end else if (en) begin
+      a_out <= a_in;
+      b_out <= b_in;
+      sum <= sum + a_in * b_in;
+    end
+  end
+endmodule
@@ -41,7 +41,12 @@ module matmul_vec #(parameter
   input [MUL_SIZE * 8 - 1:0] b_data,
   output [ADDR_BITS - 1:0] out_addr,
   output [MUL_SIZE * 8 - 1:0] out_data,
-  output out_we
+  output out_we,
+
+  /* accumulate mode: add output rows onto the current contents of the output
+     memory (out_prev, the row at out_addr) instead of overwriting them */
+  input acc,
+  input [MUL_SIZE * 8 - 1:0] out_prev
 );
 
   parameter last_idx = {ADDR_BITS{1'b1}};
@@ -87,8 +92,16 @@ module matmul_vec #(parameter
     .out_row(c_row)
   );
   assign out_addr = c_row_no;
-  assign out_data = c_row;
   assign out_we = c_ready;
 
+  /* element-wise (8-bit) sum with the previous output row */
+  genvar e;
+  generate
+    for (e = 0; e < MUL_SIZE; e = e + 1) begin : accum
+      assign out_data[e * 8 +: 8] =
+        c_row[e * 8 +: 8] + (acc ? out_prev[e * 8 +: 8] : 8'd0);
+    end
+  endgenerate
+
   assign mul_done = (c_row_no == last_idx) && c_ready;
 endmodule
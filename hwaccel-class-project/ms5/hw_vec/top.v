@@ -29,10 +29,18 @@ module top #(parameter
   MMIO_WIDTH = 32,
   /** MMIO address width */
   MMIO_ADDRBITS = 32,
-  /** DMA data width */
-  DMA_WIDTH = MUL_SIZE * 8,
+  /** DMA data width: a multiple of the matrix row width (MUL_SIZE * 8), each
+      DMA beat carries DMA_WIDTH / (MUL_SIZE * 8) consecutive rows, at most
+      one tile (MUL_SIZE rows). */
+  DMA_WIDTH = MUL_SIZE * 8 * 4,
   /** DMA address width */
-  DMA_ADDRBITS = 32
+  DMA_ADDRBITS = 32,
+  /** Number of independent contexts, each with its own registers, banks,
+      and multiplier */
+  NUM_CTX = 4,
+  /** Multiplier of each context: 0 for the sequential vector multiplier
+      (matmul_vec), 1 for the systolic array (matmul_sys, hw_sys) */
+  SYSTOLIC = 0
 ) (
   /* clock pin: wiggles up and down every cycle */
   input clk,
@@ -64,47 +72,121 @@ module top #(parameter
 
   input   dma_r_req,
   input   [DMA_ADDRBITS-1:0] dma_r_addr,
-  output  [DMA_WIDTH-1:0] dma_r_data
+  output  [DMA_WIDTH-1:0] dma_r_data,
+
+  /* 1 when a clock edge would not change any state (nothing is running). The
+     simulation harness stops clocking the design while it is idle and no MMIO
+     or DMA request is pending. Tie to 0 to always clock. */
+  output  idle
 );
 
-  /* dma offsets for the matrix memories */
+  /* dma offsets for the matrix memories. Each holds two banks of one tile
+     per context, bank b of context c starts (2 * c + b) * MUL_SIZE *
+     MUL_SIZE bytes after the offset. */
   parameter OFF_INA = 512*512;
   parameter OFF_INB = 2 * 512*512;
   parameter OFF_OUT = 3 * 512*512;
+  parameter BANK_BYTES = MUL_SIZE * MUL_SIZE;
 
   /* bits needed for address matrix rows */
   parameter ADDR_BITS = $clog2(MUL_SIZE);
 
-  /* memories for matrices */
-  reg [DMA_WIDTH-1:0] Amem [0:MUL_SIZE-1];
-  reg [DMA_WIDTH-1:0] Bmem [0:MUL_SIZE-1];
-  reg [DMA_WIDTH-1:0] outmem [0:MUL_SIZE-1];
+  /* width of a matrix row, and rows per DMA beat */
+  parameter ROW_WIDTH = MUL_SIZE * 8;
+  parameter DMA_ROWS = DMA_WIDTH / ROW_WIDTH;
+
+  /* the DMA write loops below index DMA_ROWS rows from the beat address, a
+     beat must not cover a partial row or more than one tile */
+  initial begin
+    if (DMA_WIDTH % ROW_WIDTH != 0 || DMA_ROWS < 1 || DMA_ROWS > MUL_SIZE)
+      $error("DMA_WIDTH (%0d) must be 1 to MUL_SIZE (%0d) rows of %0d bits",
+             DMA_WIDTH, MUL_SIZE, ROW_WIDTH);
+  end
+
+  /* memories for matrices, two banks per context each (ping-pong buffers):
+     while the multiplier works on one bank, DMA can fill/drain the other.
+     Input (A/B) and output banks are selected separately, so an output tile
+     can stay in place while the inputs alternate. */
+  reg [ROW_WIDTH-1:0] Amem [0:2*NUM_CTX*MUL_SIZE-1];
+  reg [ROW_WIDTH-1:0] Bmem [0:2*NUM_CTX*MUL_SIZE-1];
+  reg [ROW_WIDTH-1:0] outmem [0:2*NUM_CTX*MUL_SIZE-1];
 
+  /* Per-context state, bit c (bits 2c+1:2c for bank) is context c. */
   /* control register indicating if operation is running */
-  reg running;
+  reg [NUM_CTX-1:0] running;
   /* start register: will be set to 1 for 1 cycle at the start */
-  reg start_mul;
-
-  /* instantiate multiplication vector */
-  wire mul_done;
-  wire [ADDR_BITS-1:0] a_addr;
-  wire [ADDR_BITS-1:0] b_addr;
-  wire [ADDR_BITS-1:0] out_addr;
-  wire [DMA_WIDTH-1:0] out_data;
-  wire out_we;
-  matmul_vec#(MUL_SIZE, ADDR_BITS) mul (
-    .clk(clk),
-    .rst(rst),
-    .start_mul(start_mul),
-    .mul_done(mul_done),
-    .a_addr(a_addr),
-    .a_data(Amem[a_addr]),
-    .b_addr(b_addr),
-    .b_data(Bmem[b_addr]),
-    .out_addr(out_addr),
-    .out_data(out_data),
-    .out_we(out_we)
-  );
+  reg [NUM_CTX-1:0] start_mul;
+  /* bank register: input (bit 0) and output (bit 1) bank the next operation
+     computes on */
+  reg [2*NUM_CTX-1:0] bank;
+  /* banks the current operation computes on, latched at start */
+  reg [NUM_CTX-1:0] run_in_bank;
+  reg [NUM_CTX-1:0] run_out_bank;
+  /* current operation adds onto the output memory instead of overwriting it
+     (REG_CTRL_RSTOUT not set), latched at start */
+  reg [NUM_CTX-1:0] run_acc;
+
+  assign idle = !(|running) && !(|start_mul);
+
+  /* MMIO register windows: context c's registers start at c * 'h100 */
+  wire [MMIO_ADDRBITS-9:0] w_ctx = mmio_w_addr[MMIO_ADDRBITS-1:8];
+  wire [7:0] w_reg = mmio_w_addr[7:0];
+  wire [MMIO_ADDRBITS-9:0] r_ctx = mmio_r_addr[MMIO_ADDRBITS-1:8];
+  wire [7:0] r_reg = mmio_r_addr[7:0];
+
+  /* instantiate one multiplier per context */
+  wire [NUM_CTX-1:0] mul_done;
+  wire [NUM_CTX*ADDR_BITS-1:0] a_addr;
+  wire [NUM_CTX*ADDR_BITS-1:0] b_addr;
+  wire [NUM_CTX*ADDR_BITS-1:0] out_addr;
+  wire [NUM_CTX*ROW_WIDTH-1:0] out_data;
+  wire [NUM_CTX-1:0] out_we;
+  genvar c;
+  /* verilator lint_off WIDTH */
+  generate
+    for (c = 0; c < NUM_CTX; c = c + 1) begin : ctx
+      if (SYSTOLIC) begin : sys
+        matmul_sys#(MUL_SIZE, ADDR_BITS) mul (
+          .clk(clk),
+          .rst(rst),
+          .start_mul(start_mul[c]),
+          .mul_done(mul_done[c]),
+          .a_addr(a_addr[c*ADDR_BITS +: ADDR_BITS]),
+          .a_data(Amem[(2 * c + run_in_bank[c]) * MUL_SIZE +
+                       a_addr[c*ADDR_BITS +: ADDR_BITS]]),
+          .b_addr(b_addr[c*ADDR_BITS +: ADDR_BITS]),
+          .b_data(Bmem[(2 * c + run_in_bank[c]) * MUL_SIZE +
+                       b_addr[c*ADDR_BITS +: ADDR_BITS]]),
+          .acc(run_acc[c]),
+          .out_prev(outmem[(2 * c + run_out_bank[c]) * MUL_SIZE +
+                           out_addr[c*ADDR_BITS +: ADDR_BITS]]),
+          .out_addr(out_addr[c*ADDR_BITS +: ADDR_BITS]),
+          .out_data(out_data[c*ROW_WIDTH +: ROW_WIDTH]),
+          .out_we(out_we[c])
+        );
+      end else begin : vec
+        matmul_vec#(MUL_SIZE, ADDR_BITS) mul (
+          .clk(clk),
+          .rst(rst),
+          .start_mul(start_mul[c]),
+          .mul_done(mul_done[c]),
+          .a_addr(a_addr[c*ADDR_BITS +: ADDR_BITS]),
+          .a_data(Amem[(2 * c + run_in_bank[c]) * MUL_SIZE +
+                       a_addr[c*ADDR_BITS +: ADDR_BITS]]),
+          .b_addr(b_addr[c*ADDR_BITS +: ADDR_BITS]),
+          .b_data(Bmem[(2 * c + run_in_bank[c]) * MUL_SIZE +
+                       b_addr[c*ADDR_BITS +: ADDR_BITS]]),
+          .acc(run_acc[c]),
+          .out_prev(outmem[(2 * c + run_out_bank[c]) * MUL_SIZE +
+                           out_addr[c*ADDR_BITS +: ADDR_BITS]]),
+          .out_addr(out_addr[c*ADDR_BITS +: ADDR_BITS]),
+          .out_data(out_data[c*ROW_WIDTH +: ROW_WIDTH]),
+          .out_we(out_we[c])
+        );
+      end
+    end
+  endgenerate
+  /* verilator lint_on WIDTH */
 
   /* MMIO read output register */
   reg [MMIO_WIDTH-1:0] mmio_r_result;
@@ -114,73 +196,101 @@ module top #(parameter
   reg [DMA_WIDTH-1:0] dma_r_result;
   assign dma_r_data = dma_r_result;
 
+  integer r;
+  integer i;
   always @ (posedge clk) begin
     if (rst) begin
       running <= 0;
       mmio_r_result <= 0;
       start_mul <= 0;
+      bank <= 0;
+      run_in_bank <= 0;
+      run_out_bank <= 0;
+      run_acc <= 0;
     end else begin
+      /* verilator lint_off WIDTH */
       /* assert start mul signal for only 1 cycle */
-      if (start_mul) begin
-        start_mul <= 0;
-      end
-      /* when block signals its done, clear the running register */
-      if (mul_done) begin
-        running <= 0;
-      end
-
+      start_mul <= 0;
+      for (i = 0; i < NUM_CTX; i = i + 1) begin
+        /* when block signals its done, clear the running register */
+        if (mul_done[i]) begin
+          running[i] <= 0;
+        end
 
-      /* logic for writing to output memory when out_we is set */
-      if (out_we) begin
-        outmem[out_addr] <= out_data;
+        /* logic for writing to output memory when out_we is set */
+        if (out_we[i]) begin
+          outmem[(2 * i + run_out_bank[i]) * MUL_SIZE +
+                 out_addr[i*ADDR_BITS +: ADDR_BITS]] <=
+            out_data[i*ROW_WIDTH +: ROW_WIDTH];
+        end
       end
 
 
       /* handle MMIO writes */
-      if (mmio_w_req) begin
-        case (mmio_w_addr)
-          /* control register */ 
+      if (mmio_w_req && w_ctx < NUM_CTX) begin
+        case (w_reg)
+          /* control register */
           'h08: begin
-              running <= mmio_w_data[0];
-              if (mmio_w_data[0] && !running) begin
+              running[w_ctx] <= mmio_w_data[0];
+              if (mmio_w_data[0] && !running[w_ctx]) begin
                 /* start multiplication if not already running */
-                start_mul <= 1;
+                start_mul[w_ctx] <= 1;
+                run_in_bank[w_ctx] <= bank[2 * w_ctx];
+                run_out_bank[w_ctx] <= bank[2 * w_ctx + 1];
+                run_acc[w_ctx] <= !mmio_w_data[1];
               end
           end
+          /* bank register */
+          'h28: bank[2 * w_ctx +: 2] <= mmio_w_data[1:0];
         endcase
       end
 
       /* handle MMIO reads */
       if (mmio_r_req) begin
-        case (mmio_r_addr)
-          /* Accelerator size register */
-          'h00: mmio_r_result <= MUL_SIZE;
-          /* Control/status register */
-          'h08: mmio_r_result <= {{(MMIO_WIDTH-1){1'b0}}, {running}};
-          /* The next three registers return the (fixed) dma offsets
-             for the different buffers */
-          'h10: mmio_r_result <= OFF_INA;
-          'h18: mmio_r_result <= OFF_INB;
-          'h20: mmio_r_result <= OFF_OUT;
-        endcase
+        mmio_r_result <= 0;
+        if (r_ctx < NUM_CTX) begin
+          case (r_reg)
+            /* Accelerator size register */
+            'h00: mmio_r_result <= MUL_SIZE;
+            /* Control/status register */
+            'h08: mmio_r_result <= running[r_ctx];
+            /* The next three registers return the (fixed) dma offsets
+               for the different buffers */
+            'h10: mmio_r_result <= OFF_INA;
+            'h18: mmio_r_result <= OFF_INB;
+            'h20: mmio_r_result <= OFF_OUT;
+            /* bank register */
+            'h28: mmio_r_result <= bank[2 * r_ctx +: 2];
+            /* number of banks */
+            'h78: mmio_r_result <= 2;
+            /* number of contexts */
+            'h90: mmio_r_result <= NUM_CTX;
+          endcase
+        end
       end
 
-      /* verilator lint_off WIDTH */
-      /* Handle DMA writes */
+      /* Handle DMA writes: one beat fills DMA_ROWS rows */
       if (dma_w_req) begin
-        if ((dma_w_addr >= OFF_INA) &&
-            (dma_w_addr < (OFF_INA + MUL_SIZE * MUL_SIZE))) begin
-          Amem[dma_w_addr / (DMA_WIDTH / 8)] <= dma_w_data;
-        end
-        if ((dma_w_addr >= OFF_INB) &&
-            (dma_w_addr < (OFF_INB + MUL_SIZE * MUL_SIZE))) begin
-          Bmem[dma_w_addr / (DMA_WIDTH / 8)] <= dma_w_data;
+        for (r = 0; r < DMA_ROWS; r = r + 1) begin
+          if ((dma_w_addr >= OFF_INA) &&
+              (dma_w_addr < (OFF_INA + 2 * NUM_CTX * BANK_BYTES))) begin
+            Amem[(dma_w_addr - OFF_INA) / (ROW_WIDTH / 8) + r] <=
+              dma_w_data[r * ROW_WIDTH +: ROW_WIDTH];
+          end
+          if ((dma_w_addr >= OFF_INB) &&
+              (dma_w_addr < (OFF_INB + 2 * NUM_CTX * BANK_BYTES))) begin
+            Bmem[(dma_w_addr - OFF_INB) / (ROW_WIDTH / 8) + r] <=
+              dma_w_data[r * ROW_WIDTH +: ROW_WIDTH];
+          end
         end
       end
 
-      /* Handle DMA reads */ 
+      /* Handle DMA reads */
       if (dma_r_req) begin
-        dma_r_result <= outmem[dma_r_addr / (DMA_WIDTH / 8)];
+        for (r = 0; r < DMA_ROWS; r = r + 1) begin
+          dma_r_result[r * ROW_WIDTH +: ROW_WIDTH] <=
+            outmem[(dma_r_addr - OFF_OUT) / (ROW_WIDTH / 8) + r];
+        end
       end
       /* verilator lint_on WIDTH */
     end
@@ -53,3 +53,14 @@ def load_testfile(fn):
     fail('Loading simulation JSON output failed')
 
   return data
+
+
+def load_logfile(fn):
+  global test_fn
+  test_fn = fn
+
+  if not os.path.isfile(test_fn):
+    fail('Benchmark has not produced output')
+
+  with open(test_fn, 'r') as f:
+    return f.read().splitlines()
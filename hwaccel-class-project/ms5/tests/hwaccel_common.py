@@ -26,18 +26,33 @@ class HwAccelNode(node.NodeConfig):
 
 # Actual application to run. Includes the command to run, but also makes sure
 # the compiled binary gets copied into the disk image of the simulated machine.
+# With dma_sg=False the driver writes each DMA descriptor through the DMA
+# registers instead of handing them over as scatter-gather lists. `threads`
+# limits how many accelerator contexts (one thread each) the driver uses, and
+# `pci_dev` overrides the accelerator's PCI address (it differs under QEMU).
 class MatMulApp(node.AppConfig):
-    def __init__(self, n = None, its = None, dma = False):
+    def __init__(self, n = None, its = None, dma = False, dma_sg = None,
+                 threads = None, pci_dev = None):
         super().__init__()
         self.n = n
         self.its = its
         self.dma = dma
+        self.dma_sg = dma_sg
+        self.threads = threads
+        self.pci_dev = pci_dev
 
     def run_cmds(self, node):
+        env = ''
+        if self.dma_sg is not None:
+          env += f'MATMUL_DMA_SG={int(self.dma_sg)} '
+        if self.threads is not None:
+          env += f'MATMUL_THREADS={self.threads} '
+        if self.pci_dev is not None:
+          env += f'MATMUL_PCI_DEV={self.pci_dev} '
         if self.its is None:
-          return [f'/tmp/guest/matmul-accel {int(self.dma)} {self.n}']
+          return [f'{env}/tmp/guest/matmul-accel {int(self.dma)} {self.n}']
         else:
-          return [f'/tmp/guest/matmul-accel {int(self.dma)} {self.n} {self.its}']
+          return [f'{env}/tmp/guest/matmul-accel {int(self.dma)} {self.n} {self.its}']
 
     def config_files(self, environment: env.ExpEnv):
         # copy binary into host image during prep
@@ -49,6 +64,19 @@ class MatMulApp(node.AppConfig):
 class HWAccelSim(sim.PCIDevSim):
     sync = True
 
+    # PCIe DMA model parameters, None keeps the simulator default
+    dma_mtu = None        # max payload size per DMA request (bytes, <= 4096)
+    dma_credits = None    # max outstanding DMA requests (<= 256)
+    dma_issue_lat = None  # fixed issue latency per DMA operation (ps)
+    dma_bw = None         # DMA request bandwidth cap (MB/s)
+    stream_chunk = None   # host DMA chunk size beats are streamed at (bytes)
+
+    # signal trace of the RTL (FST), None disables tracing. Defaults can be
+    # set from the environment, e.g. ACCEL_TRACE=out/debug.fst make test1.out
+    trace = os.environ.get('ACCEL_TRACE')
+    trace_start = os.environ.get('ACCEL_TRACE_START')  # window start (ns)
+    trace_end = os.environ.get('ACCEL_TRACE_END')      # window end (ns)
+
     def __init__(self, sim, clock_period):
         super().__init__()
         self.sim = sim
@@ -58,4 +86,25 @@ class HWAccelSim(sim.PCIDevSim):
         cmd = '%s%s %d %s %s' % \
             (os.getcwd(), f'/hw_{self.sim}/sim', self.clock_period,
              env.dev_pci_path(self), env.dev_shm_path(self))
-        return cmd
+        return cmd + self.dma_args() + self.trace_args()
+
+    def dma_args(self):
+        args = ''
+        for opt, val in [('mtu', self.dma_mtu), ('credits', self.dma_credits),
+                         ('issue-lat', self.dma_issue_lat),
+                         ('bw', self.dma_bw)]:
+            if val is not None:
+                args += f' --dma-{opt}={val}'
+        if self.stream_chunk is not None:
+            args += f' --stream-chunk={self.stream_chunk}'
+        return args
+
+    def trace_args(self):
+        if self.trace is None:
+            return ''
+        args = f' --trace={os.path.abspath(self.trace)}'
+        if self.trace_start is not None:
+            args += f' --trace-start={self.trace_start}'
+        if self.trace_end is not None:
+            args += f' --trace-end={self.trace_end}'
+        return args
@@ -12,4 +12,26 @@ except:
   exception_thrown()
   fail('Parsing simulation output failed')
 
+data = load_testfile('out/test1-blocked-1.json')
+try:
+  out = data['sims']['host.host']['stdout']
+  line = find_line(out, '^STATUS: Success matrices match')
+  if not line:
+    fail('Blocked multiplication: matrices do not match')
+except:
+  exception_thrown()
+  fail('Parsing simulation output failed')
+
+for name in ['test1-bench', 'test1-bench-regs']:
+  data = load_testfile(f'out/{name}-1.json')
+  try:
+    out = data['sims']['host.host']['stdout']
+    line = find_line(out, '^Cycles per operation: ([0-9]+)')
+    if not line:
+      fail('Could not find "Cycles per operation" output')
+    print(f'BENCH {name}: {line.group(1)} cycles per 32x32 multiply')
+  except:
+    exception_thrown()
+    fail('Parsing simulation output failed')
+
 success()
\ No newline at end of file
@@ -1,5 +1,9 @@
 # TEST 1: this is a functional test for the full stack with the sequential
-# dot-product based RTL simulation.
+# dot-product based RTL simulation. test1-blocked multiplies a matrix made up
+# of several accelerator blocks, which exercises the double-buffered banks,
+# and test1-bench measures the time per multiplication for that size, with
+# the DMA descriptors handed over as scatter-gather lists and, for comparison,
+# through the DMA registers (test1-bench-regs).
 
 import sys; sys.path.append('./tests/')
 import simbricks.orchestration.experiments as exp
@@ -28,4 +32,36 @@ e.add_pcidev(hwaccel)
 e.add_host(server)
 server.wait = True
 
-experiments.append(e)
\ No newline at end of file
+experiments.append(e)
+
+
+for (name, app, cpu, sync) in [
+    ('test1-blocked', MatMulApp(32), 'X86KvmCPU', False),
+    ('test1-bench', MatMulApp(32, 3), 'TimingSimpleCPU', True),
+    ('test1-bench-regs', MatMulApp(32, 3, dma_sg=False), 'TimingSimpleCPU',
+     True)]:
+  e = exp.Experiment(name)
+
+  server_config = HwAccelNode()
+  server_config.app = app
+  if sync:
+    e.checkpoint = True
+  else:
+    server_config.nockp = True
+
+  server = sim.Gem5Host(server_config)
+  server.name = 'host'
+  server.cpu_type = cpu
+  if sync:
+    server.cpu_freq = '1GHz'
+
+  hwaccel = HWAccelSim('vec', 10000)
+  hwaccel.name = 'accel'
+  hwaccel.sync = sync
+  server.add_pcidev(hwaccel)
+
+  e.add_pcidev(hwaccel)
+  e.add_host(server)
+  server.wait = True
+
+  experiments.append(e)
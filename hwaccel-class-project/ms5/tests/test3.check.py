@@ -0,0 +1,37 @@
+from check_common import *
+
+THREADS = [1, 2, 4]
+
+test_name('test3')
+
+data = load_testfile('out/test3-blocked-1.json')
+try:
+  out = data['sims']['host.host']['stdout']
+  line = find_line(out, '^STATUS: Success matrices match')
+  if not line:
+    fail('Multi-threaded multiplication: matrices do not match')
+except:
+  exception_thrown()
+  fail('Parsing simulation output failed')
+
+for host in ['gem5', 'qemu']:
+  cycles = {}
+  for k in THREADS:
+    data = load_testfile(f'out/test3-{host}-{k}-1.json')
+    try:
+      out = data['sims']['host.host']['stdout']
+      line = find_line(out, '^Cycles per operation: ([0-9]+)')
+      if not line:
+        fail('Could not find "Cycles per operation" output')
+      cycles[k] = int(line.group(1))
+      print(f'BENCH test3-{host}-{k}: {cycles[k]} cycles per 64x64 multiply, '
+            f'{cycles[1] / cycles[k]:.2f}x of 1 context')
+    except:
+      exception_thrown()
+      fail('Parsing simulation output failed')
+
+  # QEMU's timing depends on the host it runs on, only gem5 has to scale
+  if host == 'gem5' and cycles[THREADS[-1]] >= cycles[1]:
+    fail(f'{THREADS[-1]} contexts are not faster than 1')
+
+success()
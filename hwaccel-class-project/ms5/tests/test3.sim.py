@@ -0,0 +1,75 @@
+# TEST 3: scaling with accelerator contexts. hw_vec has several contexts, each
+# with its own registers, banks, and multiplier, and the driver runs one
+# thread per context, each on its own share of the output blocks.
+# test3-blocked checks the multi-threaded result, and test3-<host>-<k>
+# measures the time per 64x64 multiplication with k threads and contexts, on
+# gem5 (TimingSimpleCPU) and on QEMU (with timing synchronization), each with
+# k cores.
+
+import sys; sys.path.append('./tests/')
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+
+from hwaccel_common import *
+
+THREADS = [1, 2, 4]
+
+experiments = []
+
+
+def make_host(host, node_config):
+  if host == 'qemu':
+    node_config.app.pci_dev = '0000:00:02.0'
+    h = sim.QemuHost(node_config)
+    h.sync = True
+  else:
+    h = sim.Gem5Host(node_config)
+    h.cpu_type = 'TimingSimpleCPU'
+    h.cpu_freq = '1GHz'
+  return h
+
+
+e = exp.Experiment('test3-blocked')
+server_config = HwAccelNode()
+server_config.app = MatMulApp(64, threads=4)
+server_config.cores = 4
+server_config.nockp = True
+
+server = sim.Gem5Host(server_config)
+server.name = 'host'
+server.cpu_type = 'X86KvmCPU'
+
+hwaccel = HWAccelSim('vec', 10000)
+hwaccel.name = 'accel'
+hwaccel.sync = False
+server.add_pcidev(hwaccel)
+
+e.add_pcidev(hwaccel)
+e.add_host(server)
+server.wait = True
+
+experiments.append(e)
+
+
+for host in ['gem5', 'qemu']:
+  for k in THREADS:
+    e = exp.Experiment(f'test3-{host}-{k}')
+    e.checkpoint = host == 'gem5'
+
+    server_config = HwAccelNode()
+    server_config.app = MatMulApp(64, 2, threads=k)
+    server_config.cores = k
+
+    server = make_host(host, server_config)
+    server.name = 'host'
+
+    hwaccel = HWAccelSim('vec', 10000)
+    hwaccel.name = 'accel'
+    hwaccel.sync = True
+    server.add_pcidev(hwaccel)
+
+    e.add_pcidev(hwaccel)
+    e.add_host(server)
+    server.wait = True
+
+    experiments.append(e)
@@ -0,0 +1,17 @@
+from check_common import *
+
+test_name('test4')
+
+for (name, what) in [('test4', 'Multiplication'),
+                     ('test4-blocked', 'Blocked multiplication')]:
+  data = load_testfile(f'out/{name}-1.json')
+  try:
+    out = data['sims']['host.host']['stdout']
+    line = find_line(out, '^STATUS: Success matrices match')
+    if not line:
+      fail(f'{what}: matrices do not match')
+  except:
+    exception_thrown()
+    fail('Parsing simulation output failed')
+
+success()
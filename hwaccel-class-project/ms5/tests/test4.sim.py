@@ -0,0 +1,34 @@
+# TEST 4: this is a functional test for the full stack with the systolic array
+# RTL simulation (hw_sys). test4-blocked multiplies a matrix made up of several
+# accelerator blocks, spread over the contexts of the shared top-level.
+
+import sys; sys.path.append('./tests/')
+import simbricks.orchestration.experiments as exp
+import simbricks.orchestration.simulators as sim
+
+from hwaccel_common import *
+
+experiments = []
+
+for (name, app) in [('test4', MatMulApp(8)),
+                    ('test4-blocked', MatMulApp(32))]:
+  e = exp.Experiment(name)
+
+  server_config = HwAccelNode()
+  server_config.app = app
+  server_config.nockp = True
+
+  server = sim.Gem5Host(server_config)
+  server.name = 'host'
+  server.cpu_type = 'X86KvmCPU'
+
+  hwaccel = HWAccelSim('sys', 10000)
+  hwaccel.name = 'accel'
+  hwaccel.sync = False
+  server.add_pcidev(hwaccel)
+
+  e.add_pcidev(hwaccel)
+  e.add_host(server)
+  server.wait = True
+
+  experiments.append(e)
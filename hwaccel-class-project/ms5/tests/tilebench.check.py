@@ -0,0 +1,19 @@
+from check_common import *
+
+test_name('tilebench')
+out = load_logfile('out/tilebench.log')
+
+try:
+  results = [l for l in out if l.startswith('BENCH ')]
+  for l in results:
+    print(l)
+  if not results:
+    fail('No benchmark results')
+  line = find_line(results, '^BENCH (.*): FAILED')
+  if line:
+    fail(f'Benchmark {line.group(1)} failed')
+except:
+  exception_thrown()
+  fail('Parsing benchmark output failed')
+
+success()